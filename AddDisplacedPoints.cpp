@@ -10,6 +10,10 @@
 //   • Selects a displacement set (BLUE or RED) based on the point number
 //   • Writes all displaced points by appending extList[i].ext and applying dx,dy,dz
 //
+// The displacement sets come from Extensions.h, or from a geometry file given
+// with --config (see default_geometry.txt), read once at startup. A geometry
+// file may define any number of named sets, each drawn in its own color.
+//
 // Additionally:
 //   • Produces a ROOT plot showing:
 //        - Original BLUE points   (large blue markers)
@@ -17,252 +21,1188 @@
 //        - Displaced points       (small black markers)
 //   • Draws the point number above (blue) or below (red) each original point
 //   • Saves the plot to AddDisplacedPoints.png and AddDisplacedPoints.root
+//     (or only the files given with --png / --root-file), from a child
+//     process started after the last CSV record is written; it overlaps
+//     only with closing the CSV and drawing the window
+//   • --no-window saves the files without the interactive window
+//
+// Points are expanded in blocks: classified, displaced by a vectorized kernel
+// working on coordinate columns (ExpandKernel.h), then formatted. With the
+// built-in geometry the kernel is specialized at compile time for the sets
+// of Extensions.h (FixedExpansion.h).
+//
+// The input is memory-mapped and its records are parsed in place, without
+// copying labels or allocating per point (PointReader.h); each block is
+// written as soon as it is expanded, so memory use does not grow with the
+// size of the input (apart from the data kept for the plot). Malformed
+// records are reported with their line and column and skipped. --stream
+// does the same reading one line at a time from an ifstream (for inputs that
+// cannot be mapped); --read-all reads the whole file with readPoints() from
+// ../common first, without those reports.
+//
+// With --threads N the points are expanded and formatted on N threads in
+// chunks; chunks are written in input order, so the CSV is identical to a
+// single-threaded run.
+//
+// --pre-transform and --post-transform apply an affine transform (a 4x4
+// matrix read from a file, e.g. a survey alignment) to the points before
+// and/or after displacement, as part of the expansion of each block
+// (Transform.h), instead of separate passes over the files.
+//
+// With --orientation angle|quaternion each input record carries the
+// orientation of its module after X,Y,Z (an angle about Z in degrees, or a
+// quaternion w,x,y,z), and its displacements are rotated into that frame
+// (label,X,Y,Z,angle → X + R·d) by the runtime kernel (ExpandKernel.h).
+// Orientations are in the input frame, like X,Y,Z: with transforms the
+// result is Post(Pre(X + R·d)).
+//
+// With --pipeline reading, expansion and writing run concurrently: the
+// reader fills batches of 8192 points, N expander threads (--threads N)
+// process them and a writer thread writes them in input order, through a
+// bounded lock-free ring (PipelineRing.h) of 2*N+2 batches. With --stream
+// or --mmap the disk and the CPU are then busy at the same time, and memory
+// stays bounded whatever the size of the input.
+//
+// With --parallel-parse the input is memory-mapped and cut into ranges of
+// whole lines, which the N threads parse as well as expand; the records
+// keep their input order and malformed lines are reported in order, with
+// their line numbers. Use it when parsing dominates (very large inputs).
+//
+// With --output-format bin64|bin32 the output is a binary columnar file
+// (ColumnarFormat.h) with float64 or int32 (0.001 mm) coordinates instead of
+// the CSV; ConvertToCsv turns it back into the CSV. The same format is
+// accepted as input (--input-format adp, or any *.adp input file), which
+// skips text parsing entirely.
+//
+// With --stats the wall and CPU time of each stage (read, classify, expand,
+// format, write, plot), the number of points per displacement set, the
+// bytes written and the peak RSS are reported on stderr at the end of the
+// run; --stats-json file also writes them as JSON (Stats.h).
+//
+// The plot data is bounded: beyond --plot-max-points points (default 200000)
+// a graph is decimated to one weighted point per grid cell, and displaced
+// points are drawn as a TH2 density (or, with --plot-style markers, as the
+// decimated markers); beyond --plot-max-labels original points (default
+// 2000) no point numbers are drawn. 0 disables either limit.
+//
+// Many files can be converted in one run, sharing the threads, buffers and
+// geometry: --file-list names a file of "input output" lines, and
+// --input-glob 'dir/*.csv' --output-dir out writes out/<name>.csv (.adp for
+// the binary formats) for every match. Nothing is plotted in this mode; a
+// file that fails is reported and the others are still processed.
+//
+// With --no-plot (or --batch) no plot data is collected and the program exits
+// as soon as the CSV is written, without starting ROOT. Builds made with
+// "make ROOT=0" contain no ROOT code at all and always run this way.
 //
 // Usage:
 //      ./AddDisplacedPoints input.csv output.csv [--no-original]
+//                           [--stream | --mmap | --read-all]
+//                           [--no-plot | --batch] [--threads N]
+//                           [--pipeline | --parallel-parse]
+//                           [--label-digits all|first|last]
+//                           [--config geometry.txt]
+//                           [--pre-transform m.txt] [--post-transform m.txt]
+//                           [--orientation none|angle|quaternion]
+//                           [--output-format csv|bin64|bin32]
+//                           [--input-format csv|adp]
+//                           [--stats] [--stats-json stats.json]
+//                           [--plot-max-points N] [--plot-max-labels N]
+//                           [--plot-style density|markers]
+//                           [--png file.png] [--root-file file.root]
+//                           [--no-window]
+//      ./AddDisplacedPoints --file-list pairs.txt [options]
+//      ./AddDisplacedPoints --input-glob 'dir/*.csv' --output-dir out [options]
 //
 //------------------------------------------------------------------------------
 
 #include <iostream>
 #include <fstream>
-#include <iomanip>
 #include <vector>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <cstdlib>
-#include <cctype>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <utility>
+
+#include <climits>
+#include <glob.h>
+#include <sys/stat.h>
 
 #include "Points.h"
-#include "Extensions.h"
-
-// ROOT includes
-#include "TApplication.h"
-#include "TCanvas.h"
-#include "TGraph.h"
-#include "TLatex.h"
-#include "TStyle.h"
-#include "TColor.h"
-#include "TROOT.h"
-#include "TFile.h"
+#include "DisplacedPoints.h"
+#include "ExpandKernel.h"
+#include "FixedExpansion.h"
+#include "ColumnarFormat.h"
+#include "PointReader.h"
+#include "PointWriter.h"
+#include "Stats.h"
+#include "Transform.h"
+#include "PipelineRing.h"
+#include "ThreadPool.h"
+
+#include "Plot.h"
+
+//------------------------------------------------------------------------------
+// Options that control how each point is expanded
+//------------------------------------------------------------------------------
+struct ExpandOptions {
+    const Geometry*        geometry      = nullptr;            // built-in or --config
+    bool                   fixedKernel   = false;              // geometry is builtinGeometry()
+    bool                   writeOriginal = true;               // --no-original clears it
+    LabelDigits            labelDigits   = LabelDigits::All;   // --label-digits
+    OutputFormat           format        = OutputFormat::Csv;  // --output-format
+    const ExtensionTable*  extTable      = nullptr;            // binary formats only
+    bool                   stats         = false;              // --stats
+    const AffineTransform* transform     = nullptr;            // --pre/--post-transform
+    Orientation            orientation   = Orientation::None;  // --orientation
+    const double*          orientLinear  = nullptr;            // its linear part (3x3), if any
+};
 
 //------------------------------------------------------------------------------
-// Extract numeric part from the label:  "C12" → 12,  "P015" → 15
+// Per-batch working storage, reused from one batch to the next
 //------------------------------------------------------------------------------
-int extractLabelNumber(const std::string& label) {
-    std::string digits;
-    for (char c : label) {
-        if (std::isdigit(static_cast<unsigned char>(c))) {
-            digits += c;
+struct BatchScratch {
+    std::vector<int>     number;    // label number of each point
+    std::vector<uint8_t> cls;       // set whose ranges contain it, or kNone
+    std::vector<uint8_t> set;       // set actually used (fallback applied)
+    DisplacedBlock       block;     // displaced coordinates (--config)
+    FixedDisplacedBlock  fixed;     // displaced coordinates (built-in geometry)
+    ColumnarBlock        columns;   // binary output block
+    std::vector<double>  tx, ty, tz; // transformed points (opt.transform)
+    StageTimes           times;     // --stats, merged after each group of batches
+    PointCounts          counts;
+    // --parallel-parse: malformed records of the batch's text range and the
+    // number of lines in it
+    std::vector<MalformedRecord> malformed;
+    long                         lines = 0;
+};
+
+//------------------------------------------------------------------------------
+// Write the originals and displaced copies of a batch in input order (CSV
+// text or one binary columnar block) and, if plot != nullptr, record what
+// the canvas needs. x, y, z are the originals (transformed if requested).
+// Block is DisplacedBlock or FixedDisplacedBlock.
+//------------------------------------------------------------------------------
+template <class Block>
+static bool writeBatch(const PointBatch& batch, const double* x, const double* y,
+                       const double* z, const Block& block, TextBuffer& out,
+                       const ExpandOptions& opt, PlotData* plot, BatchScratch& scratch) {
+
+    const Geometry& geo = *opt.geometry;
+    const size_t n = batch.size();
+
+    const bool binary = (opt.format != OutputFormat::Csv);
+    ColumnarBlock& columns = scratch.columns;
+    if (binary) {
+        columns.setType(opt.format == OutputFormat::Int32 ? CoordType::Int32
+                                                          : CoordType::Float64);
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+
+        std::string_view label = batch.label(i);
+        const DisplacementSet& set = geo.sets[scratch.set[i]];
+
+        if (binary) {
+            // Base label once, then its records
+            const std::vector<uint8_t>& extIndex = opt.extTable->setIndex[scratch.set[i]];
+            columns.addLabel(label);
+            if (opt.writeOriginal) {
+                columns.addRecord(0, x[i], y[i], z[i]);
+            }
+            for (size_t j = 0; j < set.size(); ++j) {
+                columns.addRecord(extIndex[j], block.x(i, j), block.y(i, j), block.z(i, j));
+            }
+        } else {
+            // Save original to CSV
+            if (opt.writeOriginal) {
+                out.appendPoint(label, "", x[i], y[i], z[i]);
+            }
+
+            // Save displaced points
+            for (size_t j = 0; j < set.size(); ++j) {
+                out.appendPoint(label, set.ext[j], block.x(i, j), block.y(i, j), block.z(i, j));
+            }
+        }
+
+        // Save to graph containers; only points inside a set's ranges are
+        // drawn as originals
+        if (plot) {
+            uint8_t cls = scratch.cls[i];
+            if (cls != Geometry::kNone) {
+                plot->originals[cls].add(x[i], y[i]);
+                plot->labels.push_back({static_cast<float>(x[i]), static_cast<float>(y[i]),
+                                        scratch.number[i], cls});
+            }
+            for (size_t j = 0; j < set.size(); ++j) {
+                plot->displaced.add(block.x(i, j), block.y(i, j));
+            }
         }
     }
-    if (digits.empty()) return -1;
-    return std::stoi(digits);
+
+    return binary ? columns.flush(out) : true;
 }
 
 //------------------------------------------------------------------------------
-// Check if a number lies within ANY range in a list
+// Expand a batch of points
+//   1. classify every point
+//   2. compute all displaced coordinates with the block kernel
+//   3. write them with writeBatch()
+// Returns false if a value cannot be encoded in the binary format.
 //------------------------------------------------------------------------------
-bool inAnyRange(const Range* ranges, int nRanges, int value) {
-    for (int i = 0; i < nRanges; ++i) {
-        if (value >= ranges[i].lo && value <= ranges[i].hi) {
-            return true;
+bool expandBatch(const PointBatch& batch, TextBuffer& out,
+                 const ExpandOptions& opt, PlotData* plot, BatchScratch& scratch) {
+
+    const Geometry& geo = *opt.geometry;
+    const size_t n = batch.size();
+    const double* x = batch.x();
+    const double* y = batch.y();
+    const double* z = batch.z();
+
+    StageTimer timer(opt.stats ? &scratch.times : nullptr);
+
+    scratch.number.resize(n);
+    scratch.cls.resize(n);
+    scratch.set.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        scratch.number[i] = extractLabelNumber(batch.label(i), opt.labelDigits);
+        scratch.cls[i]    = geo.classify(scratch.number[i]);
+        scratch.set[i]    = geo.selectIndex(scratch.cls[i]);
+    }
+
+    if (opt.stats) {
+        PointCounts& c = scratch.counts;
+        c.perSet.resize(geo.sets.size());
+        for (size_t i = 0; i < n; ++i) {
+            if (scratch.number[i] < 0) {
+                ++c.noDigits;
+            } else if (scratch.cls[i] == Geometry::kNone) {
+                ++c.fallback;
+            } else {
+                ++c.perSet[scratch.cls[i]];
+            }
+            c.records += geo.sets[scratch.set[i]].size() + (opt.writeOriginal ? 1 : 0);
         }
     }
-    return false;
+    timer.lap(Stage::Classify);
+
+    // The points in the output frame; the displacements of the geometry
+    // already are (see Transform.h)
+    if (opt.transform) {
+        scratch.tx.resize(n);
+        scratch.ty.resize(n);
+        scratch.tz.resize(n);
+        opt.transform->apply(x, y, z, n, scratch.tx.data(), scratch.ty.data(), scratch.tz.data());
+        x = scratch.tx.data();
+        y = scratch.ty.data();
+        z = scratch.tz.data();
+    }
+
+    bool ok;
+    if (opt.fixedKernel) {
+        scratch.fixed.compute(x, y, z, scratch.set.data(), n);
+        timer.lap(Stage::Expand);
+        ok = writeBatch(batch, x, y, z, scratch.fixed, out, opt, plot, scratch);
+    } else if (batch.oriented()) {
+        scratch.block.compute(x, y, z, batch.qw(), batch.qx(), batch.qy(), batch.qz(),
+                              scratch.set.data(), n, geo, opt.orientLinear);
+        timer.lap(Stage::Expand);
+        ok = writeBatch(batch, x, y, z, scratch.block, out, opt, plot, scratch);
+    } else {
+        scratch.block.compute(x, y, z, scratch.set.data(), n, geo);
+        timer.lap(Stage::Expand);
+        ok = writeBatch(batch, x, y, z, scratch.block, out, opt, plot, scratch);
+    }
+    timer.lap(Stage::Format);
+    return ok;
 }
 
 //------------------------------------------------------------------------------
-// Choose BLUE or RED displacement set
+// Input readers
+//   ReadAll — readPoints() from ../common (whole file in memory)
+//   Stream  — one line at a time from an ifstream
+//   Mapped  — memory-mapped file parsed in place
+//   Binary  — memory-mapped ADPCOL file (ColumnarFormat.h), no text parsing
 //------------------------------------------------------------------------------
-const Extension* chooseSet(int number, int& count) {
-    if (number >= 0 && inAnyRange(rangesBlue, numBlueRanges, number)) {
-        count = numExtBlue;
-        return extListBlue;
-    }
-    if (number >= 0 && inAnyRange(rangesRed, numRedRanges, number)) {
-        count = numExtRed;
-        return extListRed;
-    }
-    // Fallback: RED
-    count = numExtRed;
-    return extListRed;
+enum class InputMode { ReadAll, Stream, Mapped, Binary };
+
+// Call fn(label, x, y, z, q) for every input point, in file order; q is its
+// orientation (w,x,y,z) when the CSV has orientation columns, else nullptr.
+// Returns false if the input cannot be opened or fn returns false.
+template <class Fn>
+bool forEachInputPoint(const std::string& inputFile, InputMode mode, Orientation orientation,
+                       Fn&& fn) {
+
+    if (mode == InputMode::Binary) {
+
+        MappedFile mapped;
+        if (!mapped.open(inputFile)) return false;
+
+        ColumnarReader reader;
+        if (!reader.open(mapped.data(), mapped.size(), inputFile)) return false;
+
+        // Records with a label suffix become points labelled label+ext
+        std::string full;
+        bool ok = true;
+        bool complete = reader.forEach([&](std::string_view label, std::string_view ext,
+                                           double x, double y, double z) {
+            if (!ok) return;
+            if (ext.empty()) {
+                ok = fn(label, x, y, z, nullptr);
+            } else {
+                full.assign(label.data(), label.size());
+                full.append(ext.data(), ext.size());
+                ok = fn(std::string_view(full), x, y, z, nullptr);
+            }
+        });
+        return ok && complete;
+
+    } else if (mode == InputMode::Mapped) {
+
+        // Zero-copy: labels are views into the mapping
+        MappedFile mapped;
+        if (!mapped.open(inputFile)) return false;
+
+        CsvPointReader reader(mapped.begin(), mapped.end(), 1, nullptr, orientation);
+        PointRecord rec;
+        const double* q = (orientation != Orientation::None) ? rec.q : nullptr;
+        while (reader.next(rec)) {
+            if (!fn(rec.label, rec.x, rec.y, rec.z, q)) return false;
+        }
+
+    } else if (mode == InputMode::Stream) {
+
+        std::ifstream in(inputFile);
+        if (!in) {
+            std::cerr << "Error opening input file " << inputFile << "\n";
+            return false;
+        }
+
+        std::string line;
+        PointRecord rec;
+        ParseError  error;
+        const double* q = (orientation != Orientation::None) ? rec.q : nullptr;
+        long lineNo = 0;
+        while (std::getline(in, line)) {
+            ++lineNo;
+            switch (parseRecord(line.data(), line.data() + line.size(), rec, &error,
+                                orientation)) {
+            case ParseStatus::Ok:
+                if (!fn(rec.label, rec.x, rec.y, rec.z, q)) return false;
+                break;
+            case ParseStatus::Skip:
+                break;
+            case ParseStatus::Malformed:
+                reportMalformed(lineNo, error);
+                break;
+            }
+        }
+
+    } else {
+
+        // Read all points (readPoints() returns nothing for a missing file)
+        if (!std::ifstream(inputFile)) {
+            std::cerr << "Error opening input file " << inputFile << "\n";
+            return false;
+        }
+        std::vector<Point> points = readPoints(inputFile);
+
+        for (const auto& p : points) {
+            if (!fn(p.label, p.coords[0], p.coords[1], p.coords[2], nullptr)) return false;
+        }
+    }
+    return true;
 }
 
 //------------------------------------------------------------------------------
-// MAIN
+// Batched expansion (multithreaded with --threads N)
+//   Points are collected into batches; once 2*N batches are full they are
+//   expanded and formatted concurrently, each into its own buffer, and the
+//   buffers are written in input order. The output does not depend on N.
+//   With stats != nullptr, the time between groups is charged to reading.
+//   With addText() the batches are also parsed on the pool threads.
+//   One expander (threads, batches, buffers) serves any number of files in
+//   turn: start() begins the next output file.
 //------------------------------------------------------------------------------
-int main(int argc, char* argv[]) {
+class ChunkedExpander {
+public:
+    ChunkedExpander(unsigned nThreads, const ExpandOptions& opt, PlotData* plot,
+                    RunStats* stats)
+        : pool_(nThreads), opt_(opt), plot_(plot),
+          stats_(stats), timer_(stats ? &stats->times : nullptr),
+          batches_(2 * pool_.size()),
+          buffers_(batches_.size(), TextBuffer(0)), scratch_(batches_.size()),
+          plots_(plot ? batches_.size() : 0, PlotData(opt.geometry->sets.size())),
+          ranges_(batches_.size()) {}
 
-    bool writeOriginal = true;
+    // Write the points added from now on to outFile, dropping anything left
+    // over from a file that failed
+    void start(OutputFile& outFile) {
+        for (PointBatch& b : batches_) b.clear();
+        for (TextBuffer& b : buffers_) b.clear();
+        for (PlotData& p : plots_) p.clear();
+        filled_  = 0;
+        outFile_ = &outFile;
+        timer_.restart();
+    }
 
-    if (argc == 4) {
-        if (std::string(argv[3]) == "--no-original") {
-            writeOriginal = false;
-        } else {
-            std::cerr << "Unknown option: " << argv[3] << "\n";
-            return 1;
+    // Queue one point; false on write or encoding error
+    bool add(std::string_view label, double x, double y, double z, const double* q) {
+        PointBatch& b = batches_[filled_];
+        b.append(label, x, y, z);
+        if (q) b.appendOrientation(q);
+        if (b.size() < kBatchPoints) return true;
+        if (++filled_ < batches_.size()) return true;
+        return runGroup(false);
+    }
+
+    // Parse the CSV text [begin, end) on the pool threads too (--parallel-
+    // parse): it is cut into newline-aligned ranges, one per batch, that are
+    // parsed and expanded by the same task. Malformed records are reported
+    // after each group, in input order. Points added before are written first.
+    bool addText(const char* begin, const char* end) {
+        if (!finish()) return false;
+
+        long lineNo = 0;
+        while (begin < end) {
+            for (filled_ = 0; filled_ < batches_.size() && begin < end; ++filled_) {
+                const char* cut = lineBoundary(begin, end, kRangeBytes);
+                ranges_[filled_] = { begin, cut };
+                begin = cut;
+            }
+            size_t n = filled_;
+            bool ok = runGroup(true);
+
+            for (size_t i = 0; i < n; ++i) {
+                for (const MalformedRecord& m : scratch_[i].malformed) {
+                    reportMalformed(lineNo + m.line, m.error);
+                }
+                lineNo += scratch_[i].lines;
+                scratch_[i].malformed.clear();
+            }
+            if (!ok) return false;
         }
-    } else if (argc != 3) {
-        std::cerr << "Usage: " << argv[0]
-                  << " input.csv output.csv [--no-original]\n";
-        return 1;
+        return true;
     }
 
-    const std::string inputFile  = argv[1];
-    const std::string outputFile = argv[2];
+    // Expand and write whatever is still queued
+    bool finish() {
+        if (!batches_[filled_].empty()) ++filled_;
+        return runGroup(false);
+    }
 
-    // Read all points
-    std::vector<Point> points = readPoints(inputFile);
+private:
+    static constexpr size_t kBatchPoints = 8192;
+    static constexpr size_t kRangeBytes  = 256 * 1024;   // ≈ 8192 typical records
 
-    // Open output file
-    std::ofstream out(outputFile);
-    if (!out) {
-        std::cerr << "Error opening output file " << outputFile << "\n";
-        return 1;
+    struct TextRange {
+        const char* begin;
+        const char* end;
+    };
+
+    // parse: fill batch i from ranges_[i] first
+    bool runGroup(bool parse) {
+        timer_.lap(Stage::Read);
+
+        std::vector<char> encoded(filled_, 1);
+        pool_.run(filled_, [&](size_t i) {
+            if (parse) parseRange(ranges_[i], batches_[i], scratch_[i]);
+            PlotData* plot = plot_ ? &plots_[i] : nullptr;
+            encoded[i] = expandBatch(batches_[i], buffers_[i], opt_, plot, scratch_[i]);
+        });
+        timer_.restart();   // charged per batch by expandBatch()
+
+        bool ok = true;
+        for (size_t i = 0; i < filled_; ++i) ok = ok && encoded[i];
+        for (size_t i = 0; i < filled_; ++i) {
+            if (ok) ok = outFile_->write(buffers_[i]);
+            buffers_[i].clear();
+            batches_[i].clear();
+        }
+        timer_.lap(Stage::Write);
+
+        for (size_t i = 0; i < filled_; ++i) {
+            if (plot_) {
+                plot_->append(plots_[i]);
+                plots_[i].clear();
+            }
+            if (stats_) {
+                stats_->times.add(scratch_[i].times);
+                stats_->counts.add(scratch_[i].counts);
+                scratch_[i].times = StageTimes();
+                scratch_[i].counts.clear();
+            }
+        }
+        timer_.lap(Stage::Plot);
+
+        filled_ = 0;
+        return ok;
     }
 
-    out.setf(std::ios::fixed);
-    out << std::setprecision(3);
+    void parseRange(const TextRange& range, PointBatch& batch, BatchScratch& scratch) {
+        StageTimer timer(opt_.stats ? &scratch.times : nullptr);
+        CsvPointReader reader(range.begin, range.end, 1, &scratch.malformed, opt_.orientation);
+        PointRecord rec;
+        while (reader.next(rec)) {
+            batch.append(rec.label, rec.x, rec.y, rec.z);
+            if (opt_.orientation != Orientation::None) batch.appendOrientation(rec.q);
+        }
+        scratch.lines = reader.lineNumber();
+        timer.lap(Stage::Read);
+    }
 
-    //--------------------------------------------------------------------------
-    // TGraph containers for plotting
-    //--------------------------------------------------------------------------
-    std::vector<double> xb, yb;  // blue originals
-    std::vector<double> xr, yr;  // red originals
-    std::vector<double> xd, yd;  // displaced points
+    ThreadPool    pool_;
+    ExpandOptions opt_;
+    PlotData*     plot_;
+    OutputFile*   outFile_ = nullptr;
+    RunStats*     stats_;
+    StageTimer    timer_;
 
-    //--------------------------------------------------------------------------
-    // Process all points
-    //--------------------------------------------------------------------------
-    for (const auto& p : points) {
+    std::vector<PointBatch> batches_;
+    std::vector<TextBuffer> buffers_;
+    std::vector<BatchScratch> scratch_;
+    std::vector<PlotData>   plots_;
+    std::vector<TextRange>  ranges_;
+    size_t                  filled_ = 0;
+};
 
-        double x = p.coords[0];
-        double y = p.coords[1];
-        double z = p.coords[2];
+//------------------------------------------------------------------------------
+// --parallel-parse: map the input and parse it on the expander's threads
+//------------------------------------------------------------------------------
+static bool parseInParallel(const std::string& inputFile, ChunkedExpander& expander) {
+    MappedFile mapped;
+    if (!mapped.open(inputFile)) return false;
+    return expander.addText(mapped.begin(), mapped.end());
+}
 
-        int number = extractLabelNumber(p.label);
+//------------------------------------------------------------------------------
+// Pipelined expansion (--pipeline)
+//   The calling thread reads and fills batches, N expander threads classify,
+//   expand and format them, and a writer thread writes them in input order
+//   and collects the plot data; the stages exchange slots through a
+//   PipelineRing of 2*N+2 batches, so reading, expansion and writing overlap
+//   and memory stays bounded. The output is identical to ChunkedExpander.
+//------------------------------------------------------------------------------
+class PipelinedExpander {
+public:
+    PipelinedExpander(unsigned nThreads, const ExpandOptions& opt, PlotData* plot,
+                      RunStats* stats)
+        : nExpanders_(nThreads ? nThreads : 1), opt_(opt), plot_(plot), stats_(stats),
+          ring_(2 * nExpanders_ + 2, Slot(opt.geometry->sets.size())),
+          readTimer_(stats ? &readTimes_ : nullptr) {}
+
+    ~PipelinedExpander() { finish(); }
+
+    // Start the expander and writer threads on outFile
+    void start(OutputFile& outFile) {
+        finish();
+        for (size_t i = 0; i < ring_.size(); ++i) ring_[i].clear();
+        ring_.reset();
+        outFile_ = &outFile;
+        filled_  = 0;
+        claimed_.store(0, std::memory_order_relaxed);
+
+        for (unsigned i = 0; i < nExpanders_; ++i) threads_.emplace_back([this] { expandLoop(); });
+        threads_.emplace_back([this] { writeLoop(); });
+        readTimer_.restart();
+    }
+
+    // Queue one point; false once a later stage has failed
+    bool add(std::string_view label, double x, double y, double z, const double* q) {
+        PointBatch& b = ring_[filled_].batch;
+        b.append(label, x, y, z);
+        if (q) b.appendOrientation(q);
+        if (b.size() < kBatchPoints) return true;
+
+        readTimer_.lap(Stage::Read);
+        ring_.advance(filled_++, SlotStage::Filled);
+        bool ok = ring_.wait(filled_, SlotStage::Free);   // backpressure, not timed
+        readTimer_.restart();
+        return ok;
+    }
+
+    // Pass on the last batch, wait for all stages and merge their statistics
+    bool finish() {
+        if (threads_.empty()) return true;
+
+        // After an abort the slot may not have been handed back to the reader
+        if (!ring_.aborted() && !ring_[filled_].batch.empty()) {
+            ring_.advance(filled_++, SlotStage::Filled);
+        }
+        readTimer_.lap(Stage::Read);
+        ring_.close(filled_);
+        for (std::thread& t : threads_) t.join();
+        threads_.clear();
+
+        if (stats_) {
+            stats_->times.add(readTimes_);
+            stats_->times.add(writeTimes_);
+            stats_->counts.add(writeCounts_);
+            readTimes_  = writeTimes_ = StageTimes();
+            writeCounts_.clear();
+        }
+        return !ring_.aborted();
+    }
+
+private:
+    static constexpr size_t kBatchPoints = 8192;
+
+    struct Slot {
+        PointBatch   batch;
+        TextBuffer   buffer;
+        BatchScratch scratch;
+        PlotData     plot;
+        bool         encoded = true;
+
+        explicit Slot(size_t nSets) : buffer(0), plot(nSets) {}
+
+        void clear() {
+            batch.clear();
+            buffer.clear();
+            plot.clear();
+        }
+    };
+
+    // Expander threads take the sequence numbers in turn
+    void expandLoop() {
+        for (;;) {
+            uint64_t seq = claimed_.fetch_add(1, std::memory_order_relaxed);
+            if (!ring_.wait(seq, SlotStage::Filled)) return;
+
+            Slot& s = ring_[seq];
+            s.encoded = expandBatch(s.batch, s.buffer, opt_, plot_ ? &s.plot : nullptr,
+                                    s.scratch);
+            ring_.advance(seq, SlotStage::Processed);
+        }
+    }
+
+    // The writer takes them in order; merging the plot data and statistics
+    // here keeps them in input order without locks
+    void writeLoop() {
+        StageTimer timer(stats_ ? &writeTimes_ : nullptr);
+        for (uint64_t seq = 0; ring_.wait(seq, SlotStage::Processed); ++seq) {
+            Slot& s = ring_[seq];
+            timer.restart();
+            bool ok = s.encoded && outFile_->write(s.buffer);
+            s.buffer.clear();
+            s.batch.clear();
+            timer.lap(Stage::Write);
+
+            if (plot_) {
+                plot_->append(s.plot);
+                s.plot.clear();
+            }
+            if (stats_) {
+                writeTimes_.add(s.scratch.times);
+                writeCounts_.add(s.scratch.counts);
+                s.scratch.times = StageTimes();
+                s.scratch.counts.clear();
+            }
+            timer.lap(Stage::Plot);
+
+            if (!ok) {
+                ring_.abort();
+                return;
+            }
+            ring_.release(seq);
+        }
+    }
+
+    unsigned            nExpanders_;
+    ExpandOptions       opt_;
+    PlotData*           plot_;
+    RunStats*           stats_;
+    OutputFile*         outFile_ = nullptr;
+    PipelineRing<Slot>  ring_;
+
+    std::vector<std::thread> threads_;
+    uint64_t                 filled_ = 0;          // batch being filled (reader)
+    std::atomic<uint64_t>    claimed_{0};          // next batch to expand
+
+    // Per-thread statistics, merged by finish()
+    StageTimes  readTimes_;
+    StageTimer  readTimer_;
+    StageTimes  writeTimes_;
+    PointCounts writeCounts_;
+};
+
+//------------------------------------------------------------------------------
+// Files to process
+//   One input/output pair from the command line, or many with --file-list
+//   (lines "input output") or --input-glob/--output-dir
+//------------------------------------------------------------------------------
+struct FileJob {
+    std::string input;
+    std::string output;
+};
+
+// Read "input output" lines ('#' comment lines and blank lines skipped)
+static bool readFileList(const std::string& listFile, std::vector<FileJob>& jobs) {
+    std::ifstream in(listFile);
+    if (!in) {
+        std::cerr << "Error opening file list " << listFile << "\n";
+        return false;
+    }
+
+    std::string line;
+    long lineNo = 0;
+    while (std::getline(in, line)) {
+        ++lineNo;
+        std::istringstream fields(line);
+        FileJob job;
+        if (!(fields >> job.input) || job.input[0] == '#') continue;
+        std::string extra;
+        if (!(fields >> job.output) || (fields >> extra)) {
+            std::cerr << listFile << ":" << lineNo << ": expected \"input output\"\n";
+            return false;
+        }
+        jobs.push_back(job);
+    }
+    return true;
+}
+
+// Every file matching pattern → outputDir/<name without extension>.csv|.adp
+static bool globFiles(const std::string& pattern, const std::string& outputDir,
+                      OutputFormat format, std::vector<FileJob>& jobs) {
+    glob_t g;
+    int rc = glob(pattern.c_str(), 0, nullptr, &g);
+    if (rc != 0) {
+        std::cerr << (rc == GLOB_NOMATCH ? "No input files match " : "Error expanding ")
+                  << pattern << "\n";
+        globfree(&g);
+        return false;
+    }
+
+    const char* ext = (format == OutputFormat::Csv) ? ".csv" : ".adp";
+    bool ok = true;
+    for (size_t i = 0; i < g.gl_pathc; ++i) {
+        std::string input = g.gl_pathv[i];
+        std::string name  = input.substr(input.find_last_of('/') + 1);
+        size_t dot = name.find_last_of('.');
+        if (dot != std::string::npos && dot > 0) name.erase(dot);
+
+        jobs.push_back({ input, outputDir + "/" + name + ext });
+    }
+    globfree(&g);
+    return ok;
+}
+
+// A file name with its directory resolved (symlinks, "..", "./"), so that
+// two spellings of one output compare equal before the file exists
+static std::string resolvedPath(const std::string& fileName) {
+    size_t slash = fileName.find_last_of('/');
+    std::string dir  = (slash == std::string::npos) ? "." : fileName.substr(0, slash + 1);
+    std::string name = (slash == std::string::npos) ? fileName : fileName.substr(slash + 1);
+    char buf[PATH_MAX];
+    if (!realpath(dir.c_str(), buf)) return fileName;
+    return std::string(buf) + "/" + name;
+}
 
-        int nExt = 0;
-        const Extension* extList = chooseSet(number, nExt);
+// Outputs are truncated before their input is read and written without
+// looking at other jobs: refuse, before anything is opened, an output that
+// is an existing input file (compared by device and inode, so links count)
+// or that two jobs share (devices such as /dev/null may be shared)
+static bool checkJobs(const std::vector<FileJob>& jobs) {
+    using FileId = std::pair<dev_t, ino_t>;
+    std::map<FileId, const FileJob*>      inputs;
+    std::map<FileId, const FileJob*>      existingOutputs;
+    std::map<std::string, const FileJob*> outputs;
 
-        bool isBlue = (number >= 0 && inAnyRange(rangesBlue, numBlueRanges, number));
-        bool isRed  = (number >= 0 && inAnyRange(rangesRed,  numRedRanges,  number));
+    for (const FileJob& job : jobs) {
+        struct stat st;
+        if (stat(job.input.c_str(), &st) == 0) inputs.emplace(FileId(st.st_dev, st.st_ino), &job);
+    }
 
-        // Save original to CSV
-        if (writeOriginal) {
-            out << p.label << "," << x << "," << y << "," << z << "\n";
+    bool ok = true;
+    for (const FileJob& job : jobs) {
+        const FileJob* other = nullptr;
+        struct stat st;
+        if (stat(job.output.c_str(), &st) == 0) {
+            FileId id(st.st_dev, st.st_ino);
+            auto in = inputs.find(id);
+            if (in != inputs.end()) {
+                std::cerr << "Output " << job.output << " would overwrite the input "
+                          << in->second->input << "\n";
+                ok = false;
+                continue;
+            }
+            if (!S_ISREG(st.st_mode)) continue;
+            auto seen = existingOutputs.emplace(id, &job);
+            if (!seen.second) other = seen.first->second;
+        }
+        auto seen = outputs.emplace(resolvedPath(job.output), &job);
+        if (!seen.second) other = seen.first->second;
+        if (other) {
+            std::cerr << "Output " << job.output << " of " << job.input
+                      << " is also the output of " << other->input << "\n";
+            ok = false;
         }
+    }
+    return ok;
+}
+
+// Input mode for one file: binary when forced or by the .adp extension
+static InputMode inputModeFor(const std::string& inputFile, InputMode textMode,
+                              int binaryInput) {
+    if (binaryInput < 0) {
+        binaryInput = inputFile.size() > 4 &&
+                      inputFile.compare(inputFile.size() - 4, 4, ".adp") == 0;
+    }
+    return binaryInput ? InputMode::Binary : textMode;
+}
+
+// Create the output file; the binary formats start with their header
+static bool openOutput(const std::string& outputFile, const ExpandOptions& opt,
+                       OutputFile& outFile) {
+    if (!outFile.open(outputFile)) return false;
 
-        // Save original to graph containers
-        if (isBlue) {
-            xb.push_back(x);
-            yb.push_back(y);
-        } else if (isRed) {
-            xr.push_back(x);
-            yr.push_back(y);
+    if (opt.format != OutputFormat::Csv) {
+        TextBuffer header(0);
+        appendColumnarHeader(header,
+                             opt.format == OutputFormat::Int32 ? CoordType::Int32
+                                                               : CoordType::Float64,
+                             *opt.extTable);
+        if (!outFile.write(header)) return false;
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+// MAIN
+//------------------------------------------------------------------------------
+int main(int argc, char* argv[]) {
+
+    ExpandOptions opt;
+    std::string   configFile;
+    InputMode inputMode     = InputMode::Mapped;
+    int       binaryInput   = -1;   // --input-format; -1: by file extension
+    bool      makePlot      = plotAvailable();
+    PlotOptions plotOptions;
+    bool        plotFilesGiven = false;   // --png/--root-file replace the defaults
+    unsigned  nThreads      = 1;
+    bool        stats       = false;
+    std::string statsJson;
+    std::string fileList, inputGlob, outputDir;
+    bool        pipeline    = false;
+    bool        parallelParse = false;
+    std::string preTransformFile, postTransformFile;
+
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--no-original") {
+            opt.writeOriginal = false;
+        } else if (arg == "--output-format" && i + 1 < argc) {
+            const std::string format = argv[++i];
+            if (format == "csv") {
+                opt.format = OutputFormat::Csv;
+            } else if (format == "bin64") {
+                opt.format = OutputFormat::Float64;
+            } else if (format == "bin32") {
+                opt.format = OutputFormat::Int32;
+            } else {
+                std::cerr << "Invalid --output-format: " << format << "\n";
+                return 1;
+            }
+        } else if (arg == "--config" && i + 1 < argc) {
+            configFile = argv[++i];
+        } else if (arg == "--label-digits" && i + 1 < argc) {
+            const std::string mode = argv[++i];
+            if (mode == "all") {
+                opt.labelDigits = LabelDigits::All;
+            } else if (mode == "first") {
+                opt.labelDigits = LabelDigits::First;
+            } else if (mode == "last") {
+                opt.labelDigits = LabelDigits::Last;
+            } else {
+                std::cerr << "Invalid --label-digits mode: " << mode << "\n";
+                return 1;
+            }
+        } else if (arg == "--stream") {
+            inputMode = InputMode::Stream;
+        } else if (arg == "--mmap") {
+            inputMode = InputMode::Mapped;
+        } else if (arg == "--read-all") {
+            inputMode = InputMode::ReadAll;
+        } else if (arg == "--input-format" && i + 1 < argc) {
+            const std::string format = argv[++i];
+            if (format == "csv") {
+                binaryInput = 0;
+            } else if (format == "adp") {
+                binaryInput = 1;
+            } else {
+                std::cerr << "Invalid --input-format: " << format << "\n";
+                return 1;
+            }
+        } else if (arg == "--threads" && i + 1 < argc) {
+            char* end = nullptr;
+            long n = std::strtol(argv[++i], &end, 10);
+            if (*end != '\0' || n < 0 || n > 4096) {
+                std::cerr << "Invalid thread count: " << argv[i] << "\n";
+                return 1;
+            }
+            nThreads = (n == 0) ? std::thread::hardware_concurrency() : unsigned(n);
+            if (nThreads == 0) nThreads = 1;
+        } else if (arg == "--stats") {
+            stats = true;
+        } else if (arg == "--stats-json" && i + 1 < argc) {
+            stats = true;
+            statsJson = argv[++i];
+        } else if ((arg == "--plot-max-points" || arg == "--plot-max-labels") && i + 1 < argc) {
+            char* end = nullptr;
+            long long n = std::strtoll(argv[++i], &end, 10);
+            if (*end != '\0' || n < 0) {
+                std::cerr << "Invalid " << arg << ": " << argv[i] << "\n";
+                return 1;
+            }
+            if (arg == "--plot-max-points") {
+                plotOptions.maxPoints = static_cast<size_t>(n);
+            } else {
+                plotOptions.maxLabels = static_cast<size_t>(n);
+            }
+        } else if (arg == "--plot-style" && i + 1 < argc) {
+            const std::string style = argv[++i];
+            if (style == "density") {
+                plotOptions.density = true;
+            } else if (style == "markers") {
+                plotOptions.density = false;
+            } else {
+                std::cerr << "Invalid --plot-style: " << style << "\n";
+                return 1;
+            }
+        } else if ((arg == "--png" || arg == "--root-file") && i + 1 < argc) {
+            if (!plotFilesGiven) {
+                plotOptions.pngFile.clear();
+                plotOptions.rootFile.clear();
+                plotFilesGiven = true;
+            }
+            if (arg == "--png") {
+                plotOptions.pngFile = argv[++i];
+            } else {
+                plotOptions.rootFile = argv[++i];
+            }
+        } else if (arg == "--pre-transform" && i + 1 < argc) {
+            preTransformFile = argv[++i];
+        } else if (arg == "--post-transform" && i + 1 < argc) {
+            postTransformFile = argv[++i];
+        } else if (arg == "--orientation" && i + 1 < argc) {
+            const std::string mode = argv[++i];
+            if (mode == "none") {
+                opt.orientation = Orientation::None;
+            } else if (mode == "angle") {
+                opt.orientation = Orientation::AngleZ;
+            } else if (mode == "quaternion") {
+                opt.orientation = Orientation::Quaternion;
+            } else {
+                std::cerr << "Invalid --orientation mode: " << mode << "\n";
+                return 1;
+            }
+        } else if (arg == "--pipeline") {
+            pipeline = true;
+        } else if (arg == "--parallel-parse") {
+            parallelParse = true;
+        } else if (arg == "--file-list" && i + 1 < argc) {
+            fileList = argv[++i];
+        } else if (arg == "--input-glob" && i + 1 < argc) {
+            inputGlob = argv[++i];
+        } else if (arg == "--output-dir" && i + 1 < argc) {
+            outputDir = argv[++i];
+        } else if (arg == "--no-window") {
+            plotOptions.window = false;
+        } else if (arg == "--no-plot" || arg == "--batch") {
+            makePlot = false;
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            std::cerr << "Unknown option: " << arg << "\n";
+            return 1;
+        } else {
+            files.push_back(arg);
         }
+    }
 
-        // Save displaced points
-        for (int i = 0; i < nExt; ++i) {
-            const Extension& e = extList[i];
+    const bool multiFile = !fileList.empty() || !inputGlob.empty();
+    if ((multiFile ? !files.empty() : files.size() != 2) || (pipeline && parallelParse) ||
+        inputGlob.empty() != outputDir.empty() || (!fileList.empty() && !inputGlob.empty())) {
+        std::cerr << "Usage: " << argv[0]
+                  << " input.csv output.csv [--no-original]"
+                  << " [--stream | --mmap | --read-all]"
+                  << " [--no-plot | --batch] [--threads N]"
+                  << " [--pipeline | --parallel-parse]"
+                  << " [--label-digits all|first|last]"
+                  << " [--config geometry.txt]"
+                  << " [--pre-transform m.txt] [--post-transform m.txt]"
+                  << " [--orientation none|angle|quaternion]"
+                  << " [--output-format csv|bin64|bin32]"
+                  << " [--input-format csv|adp]"
+                  << " [--stats] [--stats-json stats.json]"
+                  << " [--plot-max-points N] [--plot-max-labels N]"
+                  << " [--plot-style density|markers]"
+                  << " [--png file.png] [--root-file file.root] [--no-window]\n"
+                  << "       " << argv[0]
+                  << " (--file-list pairs.txt | --input-glob 'dir/*.csv' --output-dir out)"
+                  << " [options]\n";
+        return 1;
+    }
 
-            double xp = x + e.dx;
-            double yp = y + e.dy;
-            double zp = z + e.dz;
+    // Input/output pairs; many files are processed without plots
+    std::vector<FileJob> jobs;
+    if (!fileList.empty()) {
+        if (!readFileList(fileList, jobs)) return 1;
+    } else if (!inputGlob.empty()) {
+        if (!globFiles(inputGlob, outputDir, opt.format, jobs)) return 1;
+    } else {
+        jobs.push_back({ files[0], files[1] });
+    }
+    if (!checkJobs(jobs)) return 1;
+    if (multiFile) makePlot = false;
 
-            out << p.label << e.ext << ","
-                << xp << "," << yp << "," << zp << "\n";
+    // Displacement geometry: Extensions.h unless a file is given
+    Geometry geometry;
+    if (configFile.empty()) {
+        geometry = builtinGeometry();
+    } else if (!loadGeometry(configFile, geometry)) {
+        return 1;
+    }
+    opt.geometry    = &geometry;
+    opt.fixedKernel = configFile.empty();
+    opt.stats       = stats;
 
-            xd.push_back(xp);
-            yd.push_back(yp);
+    // Coordinate transforms: the points are mapped by Post∘Pre, the
+    // displacements by the linear part of Post (Transform.h). Oriented
+    // displacements are rotated in the input frame first, so they are mapped
+    // by the linear part of Post∘Pre instead, folded into each point's
+    // rotation (the geometry is left as it is)
+    AffineTransform preTransform, postTransform;
+    if (!preTransformFile.empty() && !loadTransform(preTransformFile, preTransform)) return 1;
+    if (!postTransformFile.empty() && !loadTransform(postTransformFile, postTransform)) return 1;
+    if (!postTransform.isTranslation() && opt.orientation == Orientation::None) {
+        transformDisplacements(geometry, postTransform);
+        opt.fixedKernel = false;
+    }
+
+    // Orientation columns: expanded by the runtime kernel, which rotates the
+    // displacements (readPoints() knows only X,Y,Z)
+    if (opt.orientation != Orientation::None) {
+        if (inputMode == InputMode::ReadAll) {
+            std::cerr << "--orientation cannot be combined with --read-all\n";
+            return 1;
+        }
+        opt.fixedKernel = false;
+    }
+    AffineTransform pointTransform = postTransform.after(preTransform);
+    if (!pointTransform.isIdentity()) opt.transform = &pointTransform;
+    double orientLinear[9];
+    if (opt.orientation != Orientation::None && !pointTransform.isTranslation()) {
+        for (int r = 0; r < 3; ++r) {
+            for (int c = 0; c < 3; ++c) orientLinear[3 * r + c] = pointTransform.m[r][c];
         }
+        opt.orientLinear = orientLinear;
     }
 
-    out.close();
-    std::cout << "Wrote " << outputFile << "\n";
+    std::unique_ptr<RunStats> runStats;
+    if (stats) runStats.reset(new RunStats(geometry, statsJson));
+
+    // Label suffix table for the binary formats
+    ExtensionTable extTable;
+    if (opt.format != OutputFormat::Csv) {
+        if (!extTable.build(geometry)) return 1;
+        opt.extTable = &extTable;
+    }
 
     //--------------------------------------------------------------------------
-    // ROOT application
+    // Plot containers (filled during expansion)
     //--------------------------------------------------------------------------
-    int dummy = 0;
-    TApplication app("app", &dummy, nullptr);
-
-    TCanvas* c = new TCanvas("c", "AddDisplacedPoints", 900, 900);
-    c->SetGrid();
-
-    // All original points in one frame graph (for axes)
-    std::vector<double> xa_all = xb;
-    xa_all.insert(xa_all.end(), xr.begin(), xr.end());
-    std::vector<double> ya_all = yb;
-    ya_all.insert(ya_all.end(), yr.begin(), yr.end());
-
-    TGraph* gAll = new TGraph(xa_all.size(), xa_all.data(), ya_all.data());
-    gAll->SetMarkerSize(0); // hidden
-    gAll->Draw("AP");       // draws axes
-
-    // Blue originals
-    TGraph* gBlue = new TGraph(xb.size(), xb.data(), yb.data());
-    gBlue->SetMarkerColor(kBlue+1);
-    gBlue->SetMarkerStyle(20);
-    gBlue->SetMarkerSize(2.5);
-    gBlue->Draw("P SAME");
-
-    // Red originals
-    TGraph* gRed = new TGraph(xr.size(), xr.data(), yr.data());
-    gRed->SetMarkerColor(kRed+1);
-    gRed->SetMarkerStyle(20);
-    gRed->SetMarkerSize(2.5);
-    gRed->Draw("P SAME");
-
-    // Displaced points
-    TGraph* gDis = new TGraph(xd.size(), xd.data(), yd.data());
-    gDis->SetMarkerColor(kBlack);
-    gDis->SetMarkerStyle(20);
-    gDis->SetMarkerSize(0.8);
-    gDis->Draw("P SAME");
+    PlotData plotData(geometry.sets.size());
+    plotData.setLimits(plotOptions.maxPoints, plotOptions.maxLabels);
+    if (!plotOptions.window && !plotOptions.anyFile()) makePlot = false;
+    PlotData* plot = makePlot ? &plotData : nullptr;
 
     //--------------------------------------------------------------------------
-    // Draw labels for original points
+    // Process all files with one expander (threads and buffers are reused)
     //--------------------------------------------------------------------------
-    for (size_t i = 0; i < points.size(); ++i) {
+    std::unique_ptr<ChunkedExpander>   chunked;
+    std::unique_ptr<PipelinedExpander> pipelined;
+    if (pipeline) {
+        pipelined.reset(new PipelinedExpander(nThreads, opt, plot, runStats.get()));
+    } else {
+        chunked.reset(new ChunkedExpander(nThreads, opt, plot, runStats.get()));
+    }
+    auto add = [&](std::string_view label, double x, double y, double z, const double* q) {
+        return pipelined ? pipelined->add(label, x, y, z, q) : chunked->add(label, x, y, z, q);
+    };
 
-        int number = extractLabelNumber(points[i].label);
-        if (number < 0) continue;
+    PlotFiles plotFiles;
+    size_t failed = 0;
+    for (const FileJob& job : jobs) {
 
-        double x = points[i].coords[0];
-        double y = points[i].coords[1];
+        OutputFile outFile;
+        bool ok = openOutput(job.output, opt, outFile);
+        if (ok) {
+            if (pipelined) pipelined->start(outFile);
+            else chunked->start(outFile);
+            InputMode mode = inputModeFor(job.input, inputMode, binaryInput);
+            if (opt.orientation != Orientation::None && mode == InputMode::Binary) {
+                std::cerr << "Orientation columns need CSV input: " << job.input << "\n";
+                ok = false;
+            } else if (parallelParse && mode != InputMode::Binary) {
+                ok = parseInParallel(job.input, *chunked);
+            } else {
+                ok = forEachInputPoint(job.input, mode, opt.orientation, add);
+            }
+            // Always finish: the pipeline threads still use outFile
+            ok = (pipelined ? pipelined->finish() : chunked->finish()) && ok;
+        }
 
-        bool isBlue = inAnyRange(rangesBlue, numBlueRanges, number);
-        bool isRed  = inAnyRange(rangesRed,  numRedRanges,  number);
+        // Plot files are rendered and saved by a child process; all records
+        // have been written, so only closing the CSV and drawing the window
+        // overlap with it. The expander threads are stopped first: the
+        // child runs ROOT, which is not safe after fork() in a
+        // multithreaded process (plots are single-file only)
+        if (ok && plot) {
+            chunked.reset();
+            pipelined.reset();
+            printPlotSummary(plotData, plotOptions);
+            if (!plotFiles.start(plotData, geometry, plotOptions)) return 1;
+        }
 
-        double yLabel = y;
-        int align = 21; // center horizontally
+        StageTimer closeTimer(runStats ? &runStats->times : nullptr);
+        ok = ok && outFile.close();
+        closeTimer.lap(Stage::Write);
 
-        if (isBlue) {
-            yLabel = y + 30.0; // above
-            align = 21;
-        } else if (isRed) {
-            yLabel = y - 30.0; // below
-            align = 23;
-        } else {
+        if (!ok) {
+            outFile.discard();
+            if (multiFile) std::cerr << "Failed: " << job.input << "\n";
+            ++failed;
             continue;
         }
+        std::cout << "Wrote " << job.output << "\n";
+        if (runStats) runStats->bytesWritten += outFile.bytesWritten();
+    }
+
+    if (multiFile) {
+        std::cout << "Processed " << jobs.size() - failed << " of " << jobs.size() << " files\n";
+    }
+    if (failed) {
+        if (runStats) runStats->report();
+        return 1;
+    }
 
-        TLatex* tl = new TLatex(x, yLabel, Form("%d", number));
-        tl->SetTextColor(kBlack);
-        tl->SetTextSize(0.015);
-        tl->SetTextAlign(align);
-        tl->Draw("SAME");
+    PlotWindow window;
+    if (plot && plotOptions.window) {
+        StageTimer drawTimer(runStats ? &runStats->times : nullptr);
+        window.draw(plotData, geometry, plotOptions);
+        drawTimer.lap(Stage::Plot);
     }
 
-    c->Modified();
-    c->Update();
+    if (!plotFiles.wait(runStats.get())) return 1;
+    if (runStats && !runStats->report()) return 1;
 
-    // Save outputs
-    c->Print("AddDisplacedPoints.png");
-    TFile f("AddDisplacedPoints.root", "RECREATE");
-    c->Write();
-    f.Close();
+    // Interactive window last (skipped entirely in batch mode)
+    if (plot && plotOptions.window) window.run();
 
-    app.Run();
     return 0;
 }
@@ -0,0 +1,115 @@
+//------------------------------------------------------------------------------
+// File: BenchExpansion.cpp
+//
+// Benchmark of the displacement kernels: the runtime kernel driven by a
+// Geometry (ExpandKernel.h) against the kernel specialized at compile time
+// for Extensions.h (FixedExpansion.h), on the same synthetic points.
+//
+// Usage:
+//      ./BenchExpansion [points] [repeats]
+//
+// Built and run by "make bench".
+//------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "ExpandKernel.h"
+#include "FixedExpansion.h"
+#include "Geometry.h"
+
+static const size_t kBlock = 8192;   // points per block, as in AddDisplacedPoints
+
+//------------------------------------------------------------------------------
+// Run compute(block) for every block of the input, repeats times; returns the
+// best time in seconds
+//------------------------------------------------------------------------------
+template <class Fn>
+static double bestOf(int repeats, Fn&& fn) {
+    double best = 1e30;
+    for (int r = 0; r < repeats; ++r) {
+        auto t0 = std::chrono::steady_clock::now();
+        fn();
+        std::chrono::duration<double> dt = std::chrono::steady_clock::now() - t0;
+        if (dt.count() < best) best = dt.count();
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+
+    size_t nPoints = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 2000000;
+    int    repeats = (argc > 2) ? std::atoi(argv[2]) : 5;
+    if (nPoints == 0 || repeats <= 0) {
+        std::fprintf(stderr, "Usage: %s [points] [repeats]\n", argv[0]);
+        return 1;
+    }
+
+    // Synthetic points: coordinates within +-1000 mm, numbers 1..50 as in
+    // typical survey files (BLUE, RED and fallback points mixed)
+    Geometry geo = builtinGeometry();
+    std::mt19937_64 rng(42);
+    std::uniform_real_distribution<double> coord(-1000.0, 1000.0);
+    std::uniform_int_distribution<int> number(1, 50);
+
+    std::vector<double>  x(nPoints), y(nPoints), z(nPoints);
+    std::vector<uint8_t> set(nPoints);
+    for (size_t i = 0; i < nPoints; ++i) {
+        x[i] = coord(rng);
+        y[i] = coord(rng);
+        z[i] = coord(rng);
+        set[i] = geo.selectIndex(geo.classify(number(rng)));
+    }
+
+    DisplacedBlock      runtime;
+    FixedDisplacedBlock fixed;
+    double sink = 0;
+
+    double tRuntime = bestOf(repeats, [&] {
+        for (size_t b = 0; b < nPoints; b += kBlock) {
+            size_t n = std::min(kBlock, nPoints - b);
+            runtime.compute(&x[b], &y[b], &z[b], &set[b], n, geo);
+            sink += runtime.x(n - 1, 0);
+        }
+    });
+
+    double tFixed = bestOf(repeats, [&] {
+        for (size_t b = 0; b < nPoints; b += kBlock) {
+            size_t n = std::min(kBlock, nPoints - b);
+            fixed.compute(&x[b], &y[b], &z[b], &set[b], n);
+            sink += fixed.x(n - 1, 0);
+        }
+    });
+
+    // Both kernels must produce the same coordinates
+    size_t mismatches = 0;
+    for (size_t b = 0; b < nPoints; b += kBlock) {
+        size_t n = std::min(kBlock, nPoints - b);
+        runtime.compute(&x[b], &y[b], &z[b], &set[b], n, geo);
+        fixed.compute(&x[b], &y[b], &z[b], &set[b], n);
+        for (size_t i = 0; i < n; ++i) {
+            for (size_t j = 0; j < geo.sets[set[b + i]].size(); ++j) {
+                if (runtime.x(i, j) != fixed.x(i, j) || runtime.y(i, j) != fixed.y(i, j) ||
+                    runtime.z(i, j) != fixed.z(i, j)) {
+                    ++mismatches;
+                }
+            }
+        }
+    }
+
+    std::printf("points            %zu (best of %d)\n", nPoints, repeats);
+    std::printf("runtime kernel    %8.3f ms  %8.1f Mpoints/s\n",
+                tRuntime * 1e3, nPoints / tRuntime * 1e-6);
+    std::printf("fixed kernel      %8.3f ms  %8.1f Mpoints/s\n",
+                tFixed * 1e3, nPoints / tFixed * 1e-6);
+    std::printf("speedup           %8.2fx\n", tRuntime / tFixed);
+    std::printf("mismatches        %zu\n", mismatches);
+    if (sink == 0.123456789) std::printf("\n");   // keep the results alive
+
+    return mismatches == 0 ? 0 : 1;
+}
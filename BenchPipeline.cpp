@@ -0,0 +1,341 @@
+//------------------------------------------------------------------------------
+// File: BenchPipeline.cpp
+//
+// Throughput benchmark of the expansion pipeline, one stage at a time, on
+// synthetic input:
+//
+//   parse     CSV text → PointBatch            (CsvPointReader)
+//   classify  label number → displacement set  (extractLabelNumber, Geometry)
+//   expand    displaced coordinates            (DisplacedBlock)
+//   format    CSV text of originals + copies   (TextBuffer)
+//   write     output file                      (OutputFile)
+//
+// The input is generated in blocks of 8192 points (as AddDisplacedPoints
+// processes it) and never held in full, so any number of points can be run
+// in constant memory, e.g. --points 1000000000. Generation is not timed.
+// Every stage is reported in points/s, and in bytes/s where it consumes or
+// produces text.
+//
+// Label shapes (--labels):
+//   short     "17"
+//   prefixed  "P17"
+//   long      "survey_station_000017"
+//   nodigit   "BENCHMARK" (always the fallback set)
+//   mixed     the four above in turn
+//
+// Range tables (--ranges): 0 uses Extensions.h (9 ranges); N > 0 builds a
+// geometry of two sets with N ranges in total, spread so that N > 65536
+// exceeds the direct lookup table and uses binary search.
+//
+// Without --points/--labels/--ranges a standard matrix is run: sizes 1K,
+// 100K and 1M; every label shape at 100K; range tables of 9, 1000 and
+// 100000 ranges at 100K.
+//
+// Usage:
+//      ./BenchPipeline [--points N[,N...]] [--labels shape] [--ranges N]
+//                      [--output file]        (default /dev/null)
+//
+// Built and run by "make bench".
+//------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "DisplacedPoints.h"
+#include "ExpandKernel.h"
+#include "Geometry.h"
+#include "PointReader.h"
+#include "PointWriter.h"
+
+static const size_t kBlock = 8192;   // points per block, as in AddDisplacedPoints
+
+enum class LabelShape { Short, Prefixed, Long, NoDigit, Mixed };
+
+static const char* shapeName(LabelShape s) {
+    switch (s) {
+        case LabelShape::Short:    return "short";
+        case LabelShape::Prefixed: return "prefixed";
+        case LabelShape::Long:     return "long";
+        case LabelShape::NoDigit:  return "nodigit";
+        case LabelShape::Mixed:    return "mixed";
+    }
+    return "?";
+}
+
+static bool parseShape(const char* s, LabelShape& shape) {
+    for (LabelShape c : { LabelShape::Short, LabelShape::Prefixed, LabelShape::Long,
+                          LabelShape::NoDigit, LabelShape::Mixed }) {
+        if (std::strcmp(s, shapeName(c)) == 0) {
+            shape = c;
+            return true;
+        }
+    }
+    return false;
+}
+
+//------------------------------------------------------------------------------
+// Geometry with nRanges ranges of width 3, alternating between two sets with
+// the BLUE and RED displacements; 0 = builtinGeometry()
+//------------------------------------------------------------------------------
+static const int kRangeStride = 16;
+
+static Geometry benchGeometry(int nRanges) {
+    if (nRanges == 0) return builtinGeometry();
+
+    Geometry g;
+    Geometry builtin = builtinGeometry();
+    g.sets.push_back(builtin.sets[0]);
+    g.sets.push_back(builtin.sets[1]);
+    g.sets[0].ranges.clear();
+    g.sets[1].ranges.clear();
+    for (int i = 0; i < nRanges; ++i) {
+        int lo = i * kRangeStride + 1;
+        g.sets[i % 2].ranges.push_back({ lo, lo + 2 });
+    }
+    g.fallback = 1;
+    g.build();
+    return g;
+}
+
+// Largest label number worth generating: a little beyond the last range
+static int maxNumber(int nRanges) {
+    return nRanges == 0 ? 50 : nRanges * kRangeStride + kRangeStride;
+}
+
+//------------------------------------------------------------------------------
+// Synthetic CSV input, one block at a time
+//------------------------------------------------------------------------------
+class InputGenerator {
+public:
+    InputGenerator(LabelShape shape, int maxNumber)
+        : shape_(shape), rng_(42), number_(1, maxNumber), coord_(-100000, 100000) {}
+
+    void block(size_t n, std::string& text) {
+        text.clear();
+        char line[128];
+        for (size_t i = 0; i < n; ++i, ++count_) {
+            LabelShape s = shape_;
+            if (s == LabelShape::Mixed) s = static_cast<LabelShape>(count_ % 4);
+
+            int num = number_(rng_);
+            int len = 0;
+            switch (s) {
+                case LabelShape::Short:
+                    len = std::snprintf(line, sizeof(line), "%d", num);
+                    break;
+                case LabelShape::Prefixed:
+                    len = std::snprintf(line, sizeof(line), "P%d", num);
+                    break;
+                case LabelShape::Long:
+                    len = std::snprintf(line, sizeof(line), "survey_station_%06d", num);
+                    break;
+                default:
+                    len = std::snprintf(line, sizeof(line), "BENCHMARK");
+                    break;
+            }
+            // Coordinates in mm with 3 decimals, as in typical survey files
+            len += std::snprintf(line + len, sizeof(line) - len, ",%.3f,%.3f,%.3f\n",
+                                 coord_(rng_) * 1e-3, coord_(rng_) * 1e-3,
+                                 coord_(rng_) * 1e-3);
+            text.append(line, len);
+        }
+    }
+
+private:
+    LabelShape                         shape_;
+    std::mt19937_64                    rng_;
+    std::uniform_int_distribution<int> number_;
+    std::uniform_int_distribution<int> coord_;
+    size_t                             count_ = 0;
+};
+
+//------------------------------------------------------------------------------
+// Accumulated time and volume of one stage
+//------------------------------------------------------------------------------
+struct Stage {
+    const char* name;
+    double      seconds = 0;
+    size_t      bytes   = 0;    // text consumed or produced, 0 if none
+
+    explicit Stage(const char* n) : name(n) {}
+};
+
+using Clock = std::chrono::steady_clock;
+
+static double since(Clock::time_point t0) {
+    return std::chrono::duration<double>(Clock::now() - t0).count();
+}
+
+//------------------------------------------------------------------------------
+// Run nPoints through all stages and print one table
+//------------------------------------------------------------------------------
+static bool runPipeline(size_t nPoints, LabelShape shape, int nRanges,
+                        const std::string& outputFile) {
+
+    Geometry geo = benchGeometry(nRanges);
+    InputGenerator gen(shape, maxNumber(nRanges));
+
+    Stage parse("parse"), classify("classify"), expand("expand"),
+          format("format"), write("write");
+
+    OutputFile out;
+    if (!out.open(outputFile)) return false;
+
+    std::string          text;
+    PointBatch           batch;
+    std::vector<uint8_t> set(kBlock);
+    DisplacedBlock       block;
+    TextBuffer           buffer;
+    size_t               parsed = 0;
+
+    for (size_t done = 0; done < nPoints; done += kBlock) {
+        size_t n = std::min(kBlock, nPoints - done);
+        gen.block(n, text);
+
+        // parse
+        Clock::time_point t0 = Clock::now();
+        batch.clear();
+        CsvPointReader reader(text.data(), text.data() + text.size());
+        PointRecord rec;
+        while (reader.next(rec)) batch.append(rec.label, rec.x, rec.y, rec.z);
+        parse.seconds += since(t0);
+        parse.bytes   += text.size();
+        parsed        += batch.size();
+
+        // classify
+        t0 = Clock::now();
+        for (size_t i = 0; i < batch.size(); ++i) {
+            set[i] = geo.selectIndex(geo.classify(extractLabelNumber(batch.label(i))));
+        }
+        classify.seconds += since(t0);
+
+        // expand
+        t0 = Clock::now();
+        block.compute(batch.x(), batch.y(), batch.z(), set.data(), batch.size(), geo);
+        expand.seconds += since(t0);
+
+        // format
+        t0 = Clock::now();
+        buffer.clear();
+        for (size_t i = 0; i < batch.size(); ++i) {
+            std::string_view label = batch.label(i);
+            const DisplacementSet& s = geo.sets[set[i]];
+            buffer.appendPoint(label, "", batch.x()[i], batch.y()[i], batch.z()[i]);
+            for (size_t j = 0; j < s.size(); ++j) {
+                buffer.appendPoint(label, s.ext[j], block.x(i, j), block.y(i, j), block.z(i, j));
+            }
+        }
+        format.seconds += since(t0);
+        format.bytes   += buffer.size();
+
+        // write
+        t0 = Clock::now();
+        if (!out.write(buffer)) return false;
+        write.seconds += since(t0);
+        write.bytes   += buffer.size();
+    }
+
+    Clock::time_point t0 = Clock::now();
+    if (!out.close()) return false;
+    write.seconds += since(t0);
+
+    if (parsed != nPoints) {
+        std::fprintf(stderr, "parsed %zu of %zu points\n", parsed, nPoints);
+        return false;
+    }
+
+    std::printf("\n%zu points, labels %s, %zu ranges\n", nPoints, shapeName(shape),
+                geo.sets[0].ranges.size() + geo.sets[1].ranges.size());
+    std::printf("  %-9s %11s %13s %11s\n", "stage", "time [ms]", "Mpoints/s", "MB/s");
+
+    double total = 0;
+    for (const Stage* s : { &parse, &classify, &expand, &format, &write }) {
+        total += s->seconds;
+        std::printf("  %-9s %11.2f %13.2f", s->name, s->seconds * 1e3,
+                    nPoints / s->seconds * 1e-6);
+        if (s->bytes) std::printf(" %11.1f", s->bytes / s->seconds * 1e-6);
+        std::printf("\n");
+    }
+    std::printf("  %-9s %11.2f %13.2f %11.1f\n", "total", total * 1e3,
+                nPoints / total * 1e-6, write.bytes / total * 1e-6);
+    return true;
+}
+
+//------------------------------------------------------------------------------
+// "1000,1e6,..." → sizes
+//------------------------------------------------------------------------------
+static bool parseSizes(const char* s, std::vector<size_t>& sizes) {
+    sizes.clear();
+    while (*s) {
+        char* end = nullptr;
+        double v = std::strtod(s, &end);
+        if (end == s || v < 1 || v > 1e12) return false;
+        sizes.push_back(static_cast<size_t>(v));
+        s = end;
+        if (*s == ',') ++s;
+        else if (*s) return false;
+    }
+    return !sizes.empty();
+}
+
+int main(int argc, char** argv) {
+
+    std::vector<size_t> sizes;
+    LabelShape          shape      = LabelShape::Mixed;
+    int                 nRanges    = 0;
+    bool                custom     = false;
+    std::string         outputFile = "/dev/null";
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool ok = (i + 1 < argc);
+        if (ok && arg == "--points") {
+            ok = parseSizes(argv[++i], sizes);
+        } else if (ok && arg == "--labels") {
+            ok = parseShape(argv[++i], shape);
+        } else if (ok && arg == "--ranges") {
+            nRanges = std::atoi(argv[++i]);
+            ok = (nRanges >= 0);
+        } else if (ok && arg == "--output") {
+            outputFile = argv[++i];
+            continue;
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            std::fprintf(stderr, "Usage: %s [--points N[,N...]] [--labels short|prefixed|"
+                                 "long|nodigit|mixed] [--ranges N] [--output file]\n",
+                         argv[0]);
+            return 1;
+        }
+        custom = true;
+    }
+
+    if (custom) {
+        if (sizes.empty()) sizes.push_back(1000000);
+        for (size_t n : sizes) {
+            if (!runPipeline(n, shape, nRanges, outputFile)) return 1;
+        }
+        return 0;
+    }
+
+    // Standard matrix
+    for (size_t n : { 1000, 100000, 1000000 }) {
+        if (!runPipeline(n, LabelShape::Mixed, 0, outputFile)) return 1;
+    }
+    for (LabelShape s : { LabelShape::Short, LabelShape::Prefixed, LabelShape::Long,
+                          LabelShape::NoDigit }) {
+        if (!runPipeline(100000, s, 0, outputFile)) return 1;
+    }
+    for (int r : { 1000, 100000 }) {
+        if (!runPipeline(100000, LabelShape::Mixed, r, outputFile)) return 1;
+    }
+    return 0;
+}
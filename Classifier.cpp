@@ -0,0 +1,85 @@
+//------------------------------------------------------------------------------
+// File: Classifier.cpp
+//
+// Label number → displacement set lookup (see Classifier.h).
+//------------------------------------------------------------------------------
+
+#include "Classifier.h"
+
+#include <algorithm>
+#include <set>
+#include <utility>
+
+void RangeClassifier::add(const Range* ranges, int nRanges, uint8_t id) {
+    for (int i = 0; i < nRanges; ++i) {
+        if (ranges[i].lo > ranges[i].hi) continue;
+        entries_.push_back({ranges[i], id, static_cast<int>(entries_.size())});
+    }
+}
+
+//------------------------------------------------------------------------------
+// Sweep over range boundaries keeping the active ranges ordered by
+// precedence; each elementary segment gets the id of the earliest range
+// covering it. Adjacent segments with the same id are merged.
+//------------------------------------------------------------------------------
+void RangeClassifier::build() {
+
+    intervals_.clear();
+    table_.clear();
+    maxHi_ = -1;
+
+    // (position, order): range 'order' starts at lo and ends after hi
+    std::vector<std::pair<long long, int>> starts, stops;
+    for (const Entry& e : entries_) {
+        starts.push_back({e.range.lo, e.order});
+        stops.push_back({static_cast<long long>(e.range.hi) + 1, e.order});
+        maxHi_ = std::max(maxHi_, e.range.hi);
+    }
+    std::sort(starts.begin(), starts.end());
+    std::sort(stops.begin(), stops.end());
+
+    std::set<int> active;
+    size_t is = 0, ie = 0;
+    while (is < starts.size() || ie < stops.size()) {
+
+        long long pos = (ie == stops.size() ||
+                         (is < starts.size() && starts[is].first < stops[ie].first))
+                        ? starts[is].first : stops[ie].first;
+
+        while (ie < stops.size() && stops[ie].first == pos) active.erase(stops[ie++].second);
+        while (is < starts.size() && starts[is].first == pos) active.insert(starts[is++].second);
+
+        if (active.empty()) continue;
+
+        long long next = (is < starts.size()) ? starts[is].first : stops[ie].first;
+        if (ie < stops.size()) next = std::min(next, stops[ie].first);
+
+        uint8_t id = entries_[*active.begin()].id;
+        int lo = static_cast<int>(pos);
+        int hi = static_cast<int>(next - 1);
+
+        if (!intervals_.empty() && intervals_.back().id == id &&
+            static_cast<long long>(intervals_.back().hi) + 1 == lo) {
+            intervals_.back().hi = hi;
+        } else {
+            intervals_.push_back({lo, hi, id});
+        }
+    }
+
+    // Direct table when it stays small
+    if (maxHi_ >= 0 && maxHi_ < kMaxTable) {
+        table_.assign(static_cast<size_t>(maxHi_) + 1, kNone);
+        for (const Interval& iv : intervals_) {
+            for (int n = std::max(iv.lo, 0); n <= iv.hi; ++n) table_[n] = iv.id;
+        }
+    }
+}
+
+uint8_t RangeClassifier::search(int number) const {
+    // First interval with lo > number, then step back
+    auto it = std::upper_bound(intervals_.begin(), intervals_.end(), number,
+                               [](int v, const Interval& iv) { return v < iv.lo; });
+    if (it == intervals_.begin()) return kNone;
+    --it;
+    return (number <= it->hi) ? it->id : kNone;
+}
@@ -0,0 +1,66 @@
+/*------------------------------------------------------------------------------
+ * File: Classifier.h
+ *
+ * Label number → displacement set lookup.
+ *
+ * A RangeClassifier is built once from the range lists of Extensions.h
+ * (each list tagged with a small set id; lists added first take precedence
+ * where ranges overlap, matching the BLUE-before-RED order of chooseSet()).
+ *
+ * Lookup is O(1) through a direct table when the largest range bound is
+ * modest, and a binary search over sorted disjoint intervals otherwise
+ * (sparse or very large numbers).
+ *
+ *------------------------------------------------------------------------------*/
+
+#ifndef CLASSIFIER_H
+#define CLASSIFIER_H
+
+#include <cstdint>
+#include <vector>
+
+#include "Extensions.h"
+
+class RangeClassifier {
+public:
+    static constexpr uint8_t kNone = 0xFF;   // number not in any range
+
+    // Largest label number covered by the direct table (1 byte per entry)
+    static constexpr int kMaxTable = 1 << 20;
+
+    // Add ranges for set 'id' (< kNone); earlier calls win on overlaps
+    void add(const Range* ranges, int nRanges, uint8_t id);
+
+    // Resolve overlaps and build the lookup structures; call after add()
+    void build();
+
+    // Set id for a label number, kNone if it lies in no range (or < 0)
+    uint8_t classify(int number) const {
+        if (number < 0) return kNone;
+        if (static_cast<unsigned>(number) < table_.size()) return table_[number];
+        if (number > maxHi_) return kNone;
+        return search(number);
+    }
+
+private:
+    struct Interval {
+        int     lo;
+        int     hi;
+        uint8_t id;
+    };
+
+    struct Entry {
+        Range   range;
+        uint8_t id;
+        int     order;
+    };
+
+    uint8_t search(int number) const;
+
+    std::vector<Entry>    entries_;     // as added
+    std::vector<Interval> intervals_;   // sorted, disjoint
+    std::vector<uint8_t>  table_;       // number → id for 0..maxHi_
+    int                   maxHi_ = -1;
+};
+
+#endif // CLASSIFIER_H
@@ -0,0 +1,213 @@
+//------------------------------------------------------------------------------
+// File: ColumnarFormat.cpp
+//
+// Binary columnar point files (see ColumnarFormat.h).
+//------------------------------------------------------------------------------
+
+#include "ColumnarFormat.h"
+
+#include <iostream>
+#include <limits>
+
+static const char kMagic[8] = { 'A', 'D', 'P', 'C', 'O', 'L', '2', '\0' };
+
+static void appendU32(TextBuffer& out, uint32_t v) {
+    out.appendBytes(&v, sizeof(v));
+}
+
+//------------------------------------------------------------------------------
+// ExtensionTable
+//------------------------------------------------------------------------------
+bool ExtensionTable::build(const Geometry& geometry) {
+    names.assign(1, "");
+    setIndex.assign(geometry.sets.size(), {});
+
+    for (size_t s = 0; s < geometry.sets.size(); ++s) {
+        for (const std::string& e : geometry.sets[s].ext) {
+            size_t k = 0;
+            while (k < names.size() && names[k] != e) ++k;
+            if (k == names.size()) {
+                if (names.size() == 255) {
+                    std::cerr << "Too many distinct label suffixes for binary output\n";
+                    return false;
+                }
+                names.push_back(e);
+            }
+            setIndex[s].push_back(static_cast<uint8_t>(k));
+        }
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+// Header
+//------------------------------------------------------------------------------
+void appendColumnarHeader(TextBuffer& out, CoordType type, const ExtensionTable& ext) {
+    out.appendBytes(kMagic, sizeof(kMagic));
+    appendU32(out, static_cast<uint32_t>(type));
+    appendU32(out, static_cast<uint32_t>(ext.names.size()));
+    for (const std::string& e : ext.names) {
+        appendU32(out, static_cast<uint32_t>(e.size()));
+        out.append(e);
+    }
+}
+
+//------------------------------------------------------------------------------
+// ColumnarBlock
+//------------------------------------------------------------------------------
+void ColumnarBlock::addLabel(std::string_view label) {
+    labels_.append(label.data(), label.size());
+    labelEnd_.push_back(static_cast<uint32_t>(labels_.size()));
+    count_.push_back(0);
+}
+
+void ColumnarBlock::addRecord(uint8_t ext, double x, double y, double z) {
+    ++count_.back();
+    extIdx_.push_back(ext);
+    x_.push_back(x);
+    y_.push_back(y);
+    z_.push_back(z);
+}
+
+bool ColumnarBlock::flush(TextBuffer& out) {
+
+    const uint32_t nRecords = static_cast<uint32_t>(extIdx_.size());
+    bool ok = true;
+
+    appendU32(out, static_cast<uint32_t>(labelEnd_.size()));
+    appendU32(out, nRecords);
+    appendU32(out, static_cast<uint32_t>(labels_.size()));
+    out.append(labels_);
+    out.appendBytes(labelEnd_.data(), labelEnd_.size() * sizeof(uint32_t));
+    out.appendBytes(count_.data(), count_.size() * sizeof(uint32_t));
+    out.appendBytes(extIdx_.data(), extIdx_.size());
+
+    // Pad so the coordinate columns start 8-byte aligned within the block
+    size_t blockBytes = 12 + labels_.size() + 8 * labelEnd_.size() + size_t(nRecords);
+    static const char zeros[8] = {};
+    out.appendBytes(zeros, (8 - blockBytes % 8) % 8);
+
+    const std::vector<double>* cols[3] = { &x_, &y_, &z_ };
+    for (const std::vector<double>* col : cols) {
+        if (type_ == CoordType::Float64) {
+            out.appendBytes(col->data(), col->size() * sizeof(double));
+            continue;
+        }
+        for (double v : *col) {
+            int64_t units = 0;
+            if (!fixed3Units(v, units) ||
+                units < std::numeric_limits<int32_t>::min() ||
+                units > std::numeric_limits<int32_t>::max()) {
+                if (ok) std::cerr << "Coordinate " << v << " out of range for int32 output\n";
+                ok = false;
+                units = 0;
+            }
+            int32_t u = static_cast<int32_t>(units);
+            out.appendBytes(&u, sizeof(u));
+        }
+    }
+
+    labels_.clear();
+    labelEnd_.clear();
+    count_.clear();
+    extIdx_.clear();
+    x_.clear();
+    y_.clear();
+    z_.clear();
+    return ok;
+}
+
+//------------------------------------------------------------------------------
+// ColumnarReader
+//------------------------------------------------------------------------------
+static bool readU32(const char* data, size_t size, size_t& pos, uint32_t& v) {
+    if (size - pos < sizeof(v)) return false;
+    std::memcpy(&v, data + pos, sizeof(v));
+    pos += sizeof(v);
+    return true;
+}
+
+bool ColumnarReader::open(const char* data, size_t size, const std::string& fileName) {
+
+    data_ = data;
+    size_ = size;
+    name_ = fileName;
+    ext_.clear();
+
+    if (size < sizeof(kMagic) || std::memcmp(data, kMagic, sizeof(kMagic)) != 0) {
+        std::cerr << fileName << ": not an ADPCOL file\n";
+        return false;
+    }
+
+    size_t pos = sizeof(kMagic);
+    uint32_t type, nExt;
+    if (!readU32(data, size, pos, type) || !readU32(data, size, pos, nExt) || type > 1) {
+        std::cerr << fileName << ": corrupt ADPCOL header\n";
+        return false;
+    }
+    type_ = static_cast<CoordType>(type);
+
+    for (uint32_t i = 0; i < nExt; ++i) {
+        uint32_t len;
+        if (!readU32(data, size, pos, len) || size - pos < len) {
+            std::cerr << fileName << ": corrupt ADPCOL header\n";
+            return false;
+        }
+        ext_.emplace_back(data + pos, len);
+        pos += len;
+    }
+    first_ = pos;
+    return true;
+}
+
+bool ColumnarReader::block(size_t& pos, BlockView& b) const {
+
+    const size_t start = pos;
+    uint32_t labelBytes;
+    if (!readU32(data_, size_, pos, b.nLabels) ||
+        !readU32(data_, size_, pos, b.nRecords) ||
+        !readU32(data_, size_, pos, labelBytes)) {
+        std::cerr << name_ << ": truncated block at byte " << start << "\n";
+        return false;
+    }
+
+    const size_t coordBytes = (type_ == CoordType::Float64) ? 8 : 4;
+    size_t head = 12 + size_t(labelBytes) + 8 * size_t(b.nLabels) + size_t(b.nRecords);
+    size_t total = head + (8 - head % 8) % 8 + 3 * coordBytes * b.nRecords;
+    if (size_ - start < total) {
+        std::cerr << name_ << ": truncated block at byte " << start << "\n";
+        return false;
+    }
+
+    const char* p = data_ + pos;
+    b.labels   = p;                         p += labelBytes;
+    b.labelEnd = p;                         p += 4 * size_t(b.nLabels);
+    b.count    = p;                         p += 4 * size_t(b.nLabels);
+    b.extIdx   = reinterpret_cast<const uint8_t*>(p);
+    b.coords   = data_ + start + head + (8 - head % 8) % 8;
+    pos = start + total;
+
+    // Validate indices so forEach() never reads outside the block
+    uint32_t prev = 0;
+    uint64_t counted = 0;
+    for (uint32_t i = 0; i < b.nLabels; ++i) {
+        uint32_t e = u32(b.labelEnd, i);
+        if (e < prev || e > labelBytes) {
+            std::cerr << name_ << ": corrupt label table at byte " << start << "\n";
+            return false;
+        }
+        prev = e;
+        counted += u32(b.count, i);
+    }
+    if (counted != b.nRecords) {
+        std::cerr << name_ << ": corrupt record counts at byte " << start << "\n";
+        return false;
+    }
+    for (uint32_t r = 0; r < b.nRecords; ++r) {
+        if (b.extIdx[r] >= ext_.size()) {
+            std::cerr << name_ << ": corrupt record index at byte " << start << "\n";
+            return false;
+        }
+    }
+    return true;
+}
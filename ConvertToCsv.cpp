@@ -0,0 +1,66 @@
+//------------------------------------------------------------------------------
+// File: ConvertToCsv.cpp
+//
+// Converts a binary columnar file written by
+//      AddDisplacedPoints ... --output-format bin64|bin32
+// back to the label,X,Y,Z CSV that AddDisplacedPoints writes by default.
+//
+// For bin64 files the CSV is byte-identical to the one AddDisplacedPoints
+// would have written. bin32 files hold the printed values, so the CSV is
+// identical except that "-0.000" comes back as "0.000".
+//
+// Usage:
+//      ./ConvertToCsv input.adp output.csv
+//
+//------------------------------------------------------------------------------
+
+#include <iostream>
+#include <string>
+#include <string_view>
+
+#include "ColumnarFormat.h"
+#include "PointReader.h"
+#include "PointWriter.h"
+
+int main(int argc, char* argv[]) {
+
+    if (argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " input.adp output.csv\n";
+        return 1;
+    }
+
+    const std::string inputFile  = argv[1];
+    const std::string outputFile = argv[2];
+
+    MappedFile mapped;
+    if (!mapped.open(inputFile)) return 1;
+
+    ColumnarReader reader;
+    if (!reader.open(mapped.data(), mapped.size(), inputFile)) return 1;
+
+    OutputFile outFile;
+    if (!outFile.open(outputFile)) return 1;
+
+    const size_t flushBytes = 1 << 20;
+    TextBuffer out(2 * flushBytes);
+    bool ok = true;
+
+    bool complete = reader.forEach([&](std::string_view label, std::string_view ext,
+                                       double x, double y, double z) {
+        out.appendPoint(label, ext, x, y, z);
+        if (out.size() >= flushBytes) {
+            ok = ok && outFile.write(out);
+            out.clear();
+        }
+    });
+
+    // A truncated or corrupt input leaves no partial CSV behind
+    ok = ok && complete && outFile.write(out) && outFile.close();
+    if (!ok) {
+        outFile.discard();
+        return 1;
+    }
+
+    std::cout << "Wrote " << outputFile << "\n";
+    return 0;
+}
@@ -0,0 +1,45 @@
+//------------------------------------------------------------------------------
+// File: DisplacedPoints.cpp
+//
+// Label number extraction for the AddDisplacedPoints library
+// (see DisplacedPoints.h; the lazy expansion range is header-only).
+//------------------------------------------------------------------------------
+
+#include "DisplacedPoints.h"
+
+#include <cctype>
+#include <climits>
+
+//------------------------------------------------------------------------------
+// Extract numeric part from the label:  "C12" → 12,  "P015" → 15
+//   Returns -1 if there are no digits, or if the number does not fit in an
+//   int (such labels are treated like labels without a number).
+//------------------------------------------------------------------------------
+int extractLabelNumber(std::string_view label, LabelDigits mode) {
+
+    int  value     = -1;        // -1 until the first (counted) digit
+    bool overflow  = false;
+    bool prevDigit = false;
+
+    for (char c : label) {
+        if (!std::isdigit(static_cast<unsigned char>(c))) {
+            if (prevDigit && mode == LabelDigits::First) break;
+            prevDigit = false;
+            continue;
+        }
+        if (!prevDigit && mode == LabelDigits::Last) {
+            value    = -1;          // a new run replaces the previous one
+            overflow = false;
+        }
+        prevDigit = true;
+
+        int d = c - '0';
+        if (value < 0) value = 0;
+        if (value > (INT_MAX - d) / 10) {
+            overflow = true;
+        } else if (!overflow) {
+            value = value * 10 + d;
+        }
+    }
+    return overflow ? -1 : value;
+}
@@ -0,0 +1,220 @@
+/*------------------------------------------------------------------------------
+ * File: DisplacedPoints.h
+ *
+ * Library interface of AddDisplacedPoints: expand points in-process, with no
+ * intermediate file or vector.
+ *
+ *     Geometry geometry = builtinGeometry();      // or loadGeometry(...)
+ *     ExpandConfig config{&geometry};
+ *
+ *     for (const DisplacedPoint& dp : expand(points, config)) {
+ *         use(dp.label, dp.ext, dp.x, dp.y, dp.z);
+ *     }
+ *
+ * expand() returns a lazy range over the originals (optional) and displaced
+ * points, in the order the tool writes them. Nothing is computed until the
+ * range is iterated and nothing is stored: each displaced point is made
+ * from the current input point and one displacement when dereferenced.
+ *
+ * points can be any container (or range with begin/end) whose elements have
+ * a label and either coords[0..2] (Point from ../common/Points.h) or x,y,z
+ * members (PointRecord).
+ *
+ * The library is built as libAddDisplacedPoints.a (Geometry, Classifier,
+ * ExpandKernel, readers and writers); the AddDisplacedPoints program is a
+ * thin driver on top of it.
+ *
+ *------------------------------------------------------------------------------*/
+
+#ifndef DISPLACED_POINTS_H
+#define DISPLACED_POINTS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include "Geometry.h"
+
+/*------------------------------------------------------------------------------
+ * Which digits of a label make up its number
+ *   All   — every digit, concatenated:   "ABC015Z9" → 159
+ *   First — the first run of digits:     "ABC015Z9" → 15
+ *   Last  — the last run of digits:      "ABC015Z9" → 9
+ *------------------------------------------------------------------------------*/
+enum class LabelDigits { All, First, Last };
+
+/*------------------------------------------------------------------------------
+ * Extract numeric part from the label:  "C12" → 12,  "P015" → 15
+ *   Returns -1 if there are no digits, or if the number does not fit in an
+ *   int (such labels are treated like labels without a number).
+ *------------------------------------------------------------------------------*/
+int extractLabelNumber(std::string_view label, LabelDigits mode = LabelDigits::All);
+
+/*------------------------------------------------------------------------------
+ * How expand() expands each point
+ *------------------------------------------------------------------------------*/
+struct ExpandConfig {
+    const Geometry* geometry        = nullptr;
+    bool            includeOriginal = true;
+    LabelDigits     labelDigits     = LabelDigits::All;
+};
+
+/*------------------------------------------------------------------------------
+ * One output point. label is the input point's label and ext the suffix
+ * (empty for the original), so the full label is label + ext (name()).
+ * The views stay valid as long as the input points and the geometry do.
+ *------------------------------------------------------------------------------*/
+struct DisplacedPoint {
+    std::string_view label;
+    std::string_view ext;
+    double           x;
+    double           y;
+    double           z;
+    uint8_t          set;          // displacement set used (index into sets)
+    int              index;        // displacement index, -1 for the original
+
+    bool        isOriginal() const { return index < 0; }
+    std::string name() const { return std::string(label).append(ext); }
+};
+
+namespace adp_detail {
+
+// Point accessors: coords[k] if the type has it, otherwise x, y, z
+template <class P, class = void>
+struct HasCoords : std::false_type {};
+template <class P>
+struct HasCoords<P, std::void_t<decltype(std::declval<const P&>().coords[0])>> : std::true_type {};
+
+template <class P>
+inline void pointXYZ(const P& p, double& x, double& y, double& z) {
+    if constexpr (HasCoords<P>::value) {
+        x = p.coords[0];
+        y = p.coords[1];
+        z = p.coords[2];
+    } else {
+        x = p.x;
+        y = p.y;
+        z = p.z;
+    }
+}
+
+} // namespace adp_detail
+
+/*------------------------------------------------------------------------------
+ * Lazy range returned by expand()
+ *------------------------------------------------------------------------------*/
+template <class Points>
+class ExpansionRange {
+    using Outer = decltype(std::begin(std::declval<const Points&>()));
+
+public:
+    class iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type        = DisplacedPoint;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = const DisplacedPoint*;
+        using reference         = const DisplacedPoint&;
+
+        iterator(Outer it, Outer end, const ExpandConfig* config)
+            : it_(it), end_(end), config_(config) {
+            enterPoint();
+        }
+
+        reference operator*() const  { return current_; }
+        pointer   operator->() const { return &current_; }
+
+        iterator& operator++() {
+            if (++j_ >= static_cast<int>(set_->size())) {
+                ++it_;
+                enterPoint();
+            } else {
+                load();
+            }
+            return *this;
+        }
+
+        iterator operator++(int) {
+            iterator tmp = *this;
+            ++*this;
+            return tmp;
+        }
+
+        bool operator==(const iterator& o) const { return it_ == o.it_ && j_ == o.j_; }
+        bool operator!=(const iterator& o) const { return !(*this == o); }
+
+    private:
+        // Classify the point at it_ and position on its first output point
+        void enterPoint() {
+            const Geometry& g = *config_->geometry;
+            while (it_ != end_) {
+                const auto& p = *it_;
+                adp_detail::pointXYZ(p, x_, y_, z_);
+                uint8_t cls = g.classify(extractLabelNumber(p.label, config_->labelDigits));
+                setIndex_ = g.selectIndex(cls);
+                set_ = &g.sets[setIndex_];
+                current_.label = std::string_view(p.label);
+                current_.set = setIndex_;
+                j_ = config_->includeOriginal ? -1 : 0;
+                if (j_ < static_cast<int>(set_->size())) {
+                    load();
+                    return;
+                }
+                ++it_;          // nothing to emit for this point
+            }
+            j_ = 0;             // end position
+        }
+
+        void load() {
+            current_.index = j_;
+            if (j_ < 0) {
+                current_.ext = std::string_view();
+                current_.x = x_;
+                current_.y = y_;
+                current_.z = z_;
+            } else {
+                current_.ext = set_->ext[j_];
+                current_.x = x_ + set_->dx[j_];
+                current_.y = y_ + set_->dy[j_];
+                current_.z = z_ + set_->dz[j_];
+            }
+        }
+
+        Outer                  it_;
+        Outer                  end_;
+        const ExpandConfig*    config_;
+        const DisplacementSet* set_ = nullptr;
+        uint8_t                setIndex_ = 0;
+        int                    j_ = 0;
+        double                 x_ = 0, y_ = 0, z_ = 0;
+        DisplacedPoint         current_{};
+    };
+
+    ExpansionRange(const Points& points, const ExpandConfig& config)
+        : points_(points), config_(config) {}
+
+    iterator begin() const {
+        return iterator(std::begin(points_), std::end(points_), &config_);
+    }
+    iterator end() const {
+        return iterator(std::end(points_), std::end(points_), &config_);
+    }
+
+private:
+    const Points& points_;
+    ExpandConfig  config_;
+};
+
+/*------------------------------------------------------------------------------
+ * Lazy expansion of points (see top of file). points must outlive the range.
+ *------------------------------------------------------------------------------*/
+template <class Points>
+ExpansionRange<Points> expand(const Points& points, const ExpandConfig& config) {
+    return ExpansionRange<Points>(points, config);
+}
+
+#endif // DISPLACED_POINTS_H
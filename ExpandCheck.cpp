@@ -0,0 +1,103 @@
+//------------------------------------------------------------------------------
+// File: ExpandCheck.cpp
+//
+// Check of the library interface (DisplacedPoints.h): expands input.csv
+// with expand() twice, over std::vector<Point> from readPoints()
+// (../common) and over std::vector<PointRecord> from CsvPointReader,
+// formats every DisplacedPoint as AddDisplacedPoints does, and compares
+// both with the CSV the tool wrote for the same input and options.
+//
+// Usage:
+//      ./ExpandCheck input.csv output.csv [--no-original] [--config geometry.txt]
+//
+// Run by "make check".
+//------------------------------------------------------------------------------
+
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Points.h"
+#include "DisplacedPoints.h"
+#include "Geometry.h"
+#include "PointReader.h"
+#include "PointWriter.h"
+
+//------------------------------------------------------------------------------
+// Format expand(points) and compare it with expected; reports the first
+// differing line
+//------------------------------------------------------------------------------
+template <class Points>
+static bool check(const char* what, const Points& points, const ExpandConfig& config,
+                  std::string_view expected) {
+
+    TextBuffer out(0);
+    size_t records = 0;
+    for (const DisplacedPoint& dp : expand(points, config)) {
+        out.appendPoint(dp.label, dp.ext, dp.x, dp.y, dp.z);
+        ++records;
+    }
+
+    std::string_view got(out.data(), out.size());
+    if (got == expected) {
+        std::cout << what << ": " << records << " records, identical\n";
+        return true;
+    }
+
+    size_t at = 0;
+    while (at < got.size() && at < expected.size() && got[at] == expected[at]) ++at;
+    long line = 1;
+    for (size_t i = 0; i < at; ++i) line += (got[i] == '\n');
+    std::cerr << what << ": differs from the tool's output at line " << line << "\n";
+    return false;
+}
+
+int main(int argc, char* argv[]) {
+
+    std::vector<std::string> files;
+    std::string  configFile;
+    ExpandConfig config;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--no-original") {
+            config.includeOriginal = false;
+        } else if (arg == "--config" && i + 1 < argc) {
+            configFile = argv[++i];
+        } else {
+            files.push_back(arg);
+        }
+    }
+    if (files.size() != 2) {
+        std::cerr << "Usage: " << argv[0]
+                  << " input.csv output.csv [--no-original] [--config geometry.txt]\n";
+        return 1;
+    }
+
+    Geometry geometry;
+    if (configFile.empty()) {
+        geometry = builtinGeometry();
+    } else if (!loadGeometry(configFile, geometry)) {
+        return 1;
+    }
+    config.geometry = &geometry;
+
+    MappedFile expected;
+    if (!expected.open(files[1])) return 1;
+    std::string_view expectedText(expected.begin(), expected.size());
+
+    // Point: labels owned by the vector
+    std::vector<Point> points = readPoints(files[0]);
+
+    // PointRecord: labels are views into the mapping, which outlives them
+    MappedFile input;
+    if (!input.open(files[0])) return 1;
+    std::vector<PointRecord> records;
+    CsvPointReader reader(input.begin(), input.end());
+    PointRecord rec;
+    while (reader.next(rec)) records.push_back(rec);
+
+    bool ok = check("expand(Point)", points, config, expectedText);
+    ok = check("expand(PointRecord)", records, config, expectedText) && ok;
+    return ok ? 0 : 1;
+}
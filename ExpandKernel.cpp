@@ -0,0 +1,195 @@
+//------------------------------------------------------------------------------
+// File: ExpandKernel.cpp
+//
+// Vectorized displacement kernel (see ExpandKernel.h).
+//------------------------------------------------------------------------------
+
+#include "ExpandKernel.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+//------------------------------------------------------------------------------
+// out[i] = in[i] + d  for i in [0, n)
+//------------------------------------------------------------------------------
+static inline void addScalar(const double* in, double d, double* out, size_t n) {
+    size_t i = 0;
+#if defined(__AVX__)
+    const __m256d vd = _mm256_set1_pd(d);
+    for (; i + 4 <= n; i += 4) {
+        _mm256_storeu_pd(out + i, _mm256_add_pd(_mm256_loadu_pd(in + i), vd));
+    }
+#elif defined(__SSE2__)
+    const __m128d vd = _mm_set1_pd(d);
+    for (; i + 2 <= n; i += 2) {
+        _mm_storeu_pd(out + i, _mm_add_pd(_mm_loadu_pd(in + i), vd));
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    const float64x2_t vd = vdupq_n_f64(d);
+    for (; i + 2 <= n; i += 2) {
+        vst1q_f64(out + i, vaddq_f64(vld1q_f64(in + i), vd));
+    }
+#endif
+    for (; i < n; ++i) {
+        out[i] = in[i] + d;
+    }
+}
+
+void addDisplacements(const double* x, const double* y, const double* z, size_t nPts,
+                      const double* dx, const double* dy, const double* dz, size_t nExt,
+                      double* ox, double* oy, double* oz) {
+    for (size_t j = 0; j < nExt; ++j) {
+        addScalar(x, dx[j], ox + j * nPts, nPts);
+        addScalar(y, dy[j], oy + j * nPts, nPts);
+        addScalar(z, dz[j], oz + j * nPts, nPts);
+    }
+}
+
+void addRotatedDisplacements(const double* x, const double* y, const double* z,
+                             const double* const r[9], size_t nPts,
+                             const double* dx, const double* dy, const double* dz, size_t nExt,
+                             double* ox, double* oy, double* oz) {
+    const double* in[3]  = { x, y, z };
+    double*       out[3] = { ox, oy, oz };
+    for (size_t j = 0; j < nExt; ++j) {
+        const double dxj = dx[j], dyj = dy[j], dzj = dz[j];
+        for (int row = 0; row < 3; ++row) {
+            const double* p  = in[row];
+            const double* r0 = r[3 * row];
+            const double* r1 = r[3 * row + 1];
+            const double* r2 = r[3 * row + 2];
+            double*       o  = out[row] + j * nPts;
+            for (size_t i = 0; i < nPts; ++i) {
+                o[i] = p[i] + r0[i] * dxj + r1[i] * dyj + r2[i] * dzj;
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+// Rotation matrices of unit quaternions, element by element; with linear
+// (3x3, row-major) each is premultiplied by it
+//------------------------------------------------------------------------------
+static void rotationMatrices(const double* qw, const double* qx, const double* qy,
+                             const double* qz, size_t n, const double* linear,
+                             double* const r[9]) {
+    for (size_t i = 0; i < n; ++i) {
+        double w = qw[i], x = qx[i], y = qy[i], z = qz[i];
+        r[0][i] = 1 - 2 * (y * y + z * z);
+        r[1][i] = 2 * (x * y - w * z);
+        r[2][i] = 2 * (x * z + w * y);
+        r[3][i] = 2 * (x * y + w * z);
+        r[4][i] = 1 - 2 * (x * x + z * z);
+        r[5][i] = 2 * (y * z - w * x);
+        r[6][i] = 2 * (x * z - w * y);
+        r[7][i] = 2 * (y * z + w * x);
+        r[8][i] = 1 - 2 * (x * x + y * y);
+    }
+    if (!linear) return;
+
+    for (size_t i = 0; i < n; ++i) {
+        double m[9];
+        for (int k = 0; k < 9; ++k) m[k] = r[k][i];
+        for (int row = 0; row < 3; ++row) {
+            const double* l = linear + 3 * row;
+            for (int col = 0; col < 3; ++col) {
+                r[3 * row + col][i] = l[0] * m[col] + l[1] * m[3 + col] + l[2] * m[6 + col];
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+// DisplacedBlock
+//------------------------------------------------------------------------------
+
+// Gather each set's points (and orientations, if q != nullptr) into
+// contiguous columns
+void DisplacedBlock::gather(const double* x, const double* y, const double* z,
+                            const double* const q[4], const uint8_t* set, size_t n,
+                            size_t nSets) {
+    set_ = set;
+    slot_.resize(n);
+    if (groups_.size() < nSets) groups_.resize(nSets);
+
+    for (Group& g : groups_) {
+        g.x.clear();
+        g.y.clear();
+        g.z.clear();
+        g.qw.clear();
+        g.qx.clear();
+        g.qy.clear();
+        g.qz.clear();
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        Group& g = groups_[set[i]];
+        slot_[i] = static_cast<uint32_t>(g.x.size());
+        g.x.push_back(x[i]);
+        g.y.push_back(y[i]);
+        g.z.push_back(z[i]);
+        if (q) {
+            g.qw.push_back(q[0][i]);
+            g.qx.push_back(q[1][i]);
+            g.qy.push_back(q[2][i]);
+            g.qz.push_back(q[3][i]);
+        }
+    }
+}
+
+void DisplacedBlock::compute(const double* x, const double* y, const double* z,
+                             const uint8_t* set, size_t n, const Geometry& geometry) {
+
+    gather(x, y, z, nullptr, set, n, geometry.sets.size());
+
+    // One kernel call per set
+    for (size_t s = 0; s < geometry.sets.size(); ++s) {
+        Group& g = groups_[s];
+        const DisplacementSet& ds = geometry.sets[s];
+        size_t nPts = g.x.size();
+        if (nPts == 0 || ds.size() == 0) continue;
+
+        g.ox.resize(nPts * ds.size());
+        g.oy.resize(nPts * ds.size());
+        g.oz.resize(nPts * ds.size());
+        addDisplacements(g.x.data(), g.y.data(), g.z.data(), nPts,
+                         ds.dx.data(), ds.dy.data(), ds.dz.data(), ds.size(),
+                         g.ox.data(), g.oy.data(), g.oz.data());
+    }
+}
+
+void DisplacedBlock::compute(const double* x, const double* y, const double* z,
+                             const double* qw, const double* qx, const double* qy,
+                             const double* qz, const uint8_t* set, size_t n,
+                             const Geometry& geometry, const double* linear) {
+
+    const double* const q[4] = { qw, qx, qy, qz };
+    gather(x, y, z, q, set, n, geometry.sets.size());
+
+    // Rotation matrices, then one kernel call per set
+    for (size_t s = 0; s < geometry.sets.size(); ++s) {
+        Group& g = groups_[s];
+        const DisplacementSet& ds = geometry.sets[s];
+        size_t nPts = g.x.size();
+        if (nPts == 0 || ds.size() == 0) continue;
+
+        double* r[9];
+        for (int k = 0; k < 9; ++k) {
+            g.r[k].resize(nPts);
+            r[k] = g.r[k].data();
+        }
+        rotationMatrices(g.qw.data(), g.qx.data(), g.qy.data(), g.qz.data(), nPts, linear, r);
+
+        g.ox.resize(nPts * ds.size());
+        g.oy.resize(nPts * ds.size());
+        g.oz.resize(nPts * ds.size());
+        addRotatedDisplacements(g.x.data(), g.y.data(), g.z.data(), r, nPts,
+                                ds.dx.data(), ds.dy.data(), ds.dz.data(), ds.size(),
+                                g.ox.data(), g.oy.data(), g.oz.data());
+    }
+}
@@ -0,0 +1,99 @@
+/*------------------------------------------------------------------------------
+ * File: ExpandKernel.h
+ *
+ * Compute core of AddDisplacedPoints: displaced coordinates for a block of
+ * points, separate from classification and formatting.
+ *
+ * Contents:
+ *   • addDisplacements() — SoA kernel: every point of a block plus every
+ *                          displacement of one set (vectorized adds)
+ *   • addRotatedDisplacements()
+ *                        — the same for points with their own orientation:
+ *                          each displacement rotated by the point's 3x3
+ *                          matrix (--orientation)
+ *   • DisplacedBlock     — runs the kernel for a block whose points belong
+ *                          to different sets and gives access to the result
+ *                          in input order
+ *
+ * The kernel uses AVX or SSE2 on x86-64 and NEON on ARM when the compiler
+ * targets them (e.g. make ARCHFLAGS=-march=native), and a plain loop
+ * otherwise. All paths perform the same IEEE additions, so results are
+ * bit-identical. The rotated kernel is written as plain loops over point
+ * columns, which the compiler vectorizes.
+ *
+ *------------------------------------------------------------------------------*/
+
+#ifndef EXPAND_KERNEL_H
+#define EXPAND_KERNEL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Geometry.h"
+
+/*------------------------------------------------------------------------------
+ * For nPts points and nExt displacements:
+ *     ox[j*nPts + i] = x[i] + dx[j]     (same for y, z)
+ *------------------------------------------------------------------------------*/
+void addDisplacements(const double* x, const double* y, const double* z, size_t nPts,
+                      const double* dx, const double* dy, const double* dz, size_t nExt,
+                      double* ox, double* oy, double* oz);
+
+/*------------------------------------------------------------------------------
+ * For nPts points with rotation matrices r (r[3*row + col][i] is element
+ * row,col of point i) and nExt displacements:
+ *     ox[j*nPts + i] = x[i] + r[0][i]*dx[j] + r[1][i]*dy[j] + r[2][i]*dz[j]
+ * and likewise oy, oz with rows 1 and 2
+ *------------------------------------------------------------------------------*/
+void addRotatedDisplacements(const double* x, const double* y, const double* z,
+                             const double* const r[9], size_t nPts,
+                             const double* dx, const double* dy, const double* dz, size_t nExt,
+                             double* ox, double* oy, double* oz);
+
+/*------------------------------------------------------------------------------
+ * Displaced coordinates of a block of points
+ *   compute() gathers the points of each set into contiguous columns, runs
+ *   addDisplacements() once per set, and records where each point went.
+ *   x(i, j), y(i, j), z(i, j) then return displacement j of point i.
+ *   With orientations (unit quaternions w,x,y,z per point) the
+ *   displacements of each point are first rotated into its frame; with
+ *   linear (3x3, row-major, or nullptr) they are then also mapped by it,
+ *   i.e. point i is displaced by linear * R(q[i]) * d.
+ *------------------------------------------------------------------------------*/
+class DisplacedBlock {
+public:
+    void compute(const double* x, const double* y, const double* z,
+                 const uint8_t* set, size_t n, const Geometry& geometry);
+
+    void compute(const double* x, const double* y, const double* z,
+                 const double* qw, const double* qx, const double* qy, const double* qz,
+                 const uint8_t* set, size_t n, const Geometry& geometry,
+                 const double* linear = nullptr);
+
+    double x(size_t i, size_t j) const { return at(i, j, &Group::ox); }
+    double y(size_t i, size_t j) const { return at(i, j, &Group::oy); }
+    double z(size_t i, size_t j) const { return at(i, j, &Group::oz); }
+
+private:
+    struct Group {
+        std::vector<double> x, y, z;        // gathered points of one set
+        std::vector<double> qw, qx, qy, qz; // and their orientations
+        std::vector<double> r[9];           // rotation matrices, by element
+        std::vector<double> ox, oy, oz;     // displaced, [ext][point]
+    };
+
+    void gather(const double* x, const double* y, const double* z, const double* const q[4],
+                const uint8_t* set, size_t n, size_t nSets);
+
+    double at(size_t i, size_t j, std::vector<double> Group::*col) const {
+        const Group& g = groups_[set_[i]];
+        return (g.*col)[j * g.x.size() + slot_[i]];
+    }
+
+    const uint8_t*        set_ = nullptr;
+    std::vector<uint32_t> slot_;            // position of point i in its group
+    std::vector<Group>    groups_;          // one per set
+};
+
+#endif // EXPAND_KERNEL_H
@@ -16,16 +16,20 @@
  * This header provides ALL configuration and geometry used by the program.
  * AddDisplacedPoints.cpp contains the logic only.
  *
- * All values in this file are meant to be user-editable.
+ * All values in this file are meant to be user-editable. They are constant
+ * expressions (cx::sqrt/sin/cos from ConstexprMath.h instead of std::), so
+ * the displacement lists can be compiled into the expansion kernel
+ * (FixedExpansion.h).
  *
  *------------------------------------------------------------------------------*/
 
 #ifndef EXTENSIONS_H
 #define EXTENSIONS_H
 
-#include <cmath>
 #include <string>
 
+#include "ConstexprMath.h"
+
 /*------------------------------------------------------------------------------
  * Mathematical constants
  *------------------------------------------------------------------------------*/
@@ -41,7 +45,7 @@ constexpr double r = 2.0;
  * Diagonal offset for 45° displacements (mm)
  *   D = r / sqrt(2)
  *------------------------------------------------------------------------------*/
-const double D = r / std::sqrt(2.0);
+constexpr double D = r / cx::sqrt(2.0);
 
 /*------------------------------------------------------------------------------
  * Large radial displacement (mm)
@@ -108,7 +112,7 @@ struct Extension {
  *   First 4: 45° diagonals
  *   Next 3:  Large radial offsets (angles a1, a2, a3)
  *------------------------------------------------------------------------------*/
-const Extension extListBlue[] = {
+constexpr Extension extListBlue[] = {
 
     // 45° diagonal offsets
     {"_1", +D, +D, 0.0},      // up-right
@@ -117,9 +121,9 @@ const Extension extListBlue[] = {
     {"_4", +D, -D, 0.0},      // down-right
 
     // Large radial offsets (BLUE)
-    {"_5", R*std::cos(a1), R*std::sin(a1), -6.},
-    {"_6", R*std::cos(a2), R*std::sin(a2), -6.},
-    {"_7", R*std::cos(a3), R*std::sin(a3), -6.}
+    {"_5", R*cx::cos(a1), R*cx::sin(a1), -6.},
+    {"_6", R*cx::cos(a2), R*cx::sin(a2), -6.},
+    {"_7", R*cx::cos(a3), R*cx::sin(a3), -6.}
 };
 const int numExtBlue = sizeof(extListBlue) / sizeof(extListBlue[0]);
 
@@ -128,7 +132,7 @@ const int numExtBlue = sizeof(extListBlue) / sizeof(extListBlue[0]);
  *   First 4: 45° diagonals (same as BLUE)
  *   Next 3:  Large radial offsets with Y reversed (mirror)
  *------------------------------------------------------------------------------*/
-const Extension extListRed[] = {
+constexpr Extension extListRed[] = {
 
     // 45° diagonal offsets (same as BLUE)
     {"_1", +D, +D, 0.0},
@@ -137,9 +141,9 @@ const Extension extListRed[] = {
     {"_4", +D, -D, 0.0},
 
     // Large radial offsets (RED mirrors in Y)
-    {"_5", R*std::cos(a1), -R*std::sin(a1), -6.},
-    {"_6", R*std::cos(a2), -R*std::sin(a2), -6.},
-    {"_7", R*std::cos(a3), -R*std::sin(a3), -6.}
+    {"_5", R*cx::cos(a1), -R*cx::sin(a1), -6.},
+    {"_6", R*cx::cos(a2), -R*cx::sin(a2), -6.},
+    {"_7", R*cx::cos(a3), -R*cx::sin(a3), -6.}
 };
 const int numExtRed = sizeof(extListRed) / sizeof(extListRed[0]);
 
@@ -0,0 +1,60 @@
+//------------------------------------------------------------------------------
+// File: FixedExpansion.cpp
+//
+// Compile-time specialized displacement kernel (see FixedExpansion.h).
+//------------------------------------------------------------------------------
+
+#include "FixedExpansion.h"
+
+#include <utility>
+
+//------------------------------------------------------------------------------
+// Both sets padded to kFixedStride, so that one unrolled loop serves both
+//------------------------------------------------------------------------------
+template <size_t N>
+static constexpr FixedSet<kFixedStride> pad(const FixedSet<N>& s) {
+    FixedSet<kFixedStride> p;
+    for (size_t j = 0; j < N; ++j) {
+        p.dx[j] = s.dx[j];
+        p.dy[j] = s.dy[j];
+        p.dz[j] = s.dz[j];
+    }
+    return p;
+}
+
+static constexpr FixedSet<kFixedStride> kBlue = pad(kFixedBlue);
+static constexpr FixedSet<kFixedStride> kRed  = pad(kFixedRed);
+
+//------------------------------------------------------------------------------
+// All displacements of one point, one statement per displacement; the set is
+// selected per offset (a conditional move between two constants) instead of
+// by a branch, which would be unpredictable for mixed BLUE/RED input
+//------------------------------------------------------------------------------
+template <size_t... J>
+static inline void displace(double x, double y, double z, bool red,
+                            double* ox, double* oy, double* oz,
+                            std::index_sequence<J...>) {
+    ((ox[J] = x + (red ? kRed.dx[J] : kBlue.dx[J])), ...);
+    ((oy[J] = y + (red ? kRed.dy[J] : kBlue.dy[J])), ...);
+    ((oz[J] = z + (red ? kRed.dz[J] : kBlue.dz[J])), ...);
+}
+
+//------------------------------------------------------------------------------
+// FixedDisplacedBlock
+//------------------------------------------------------------------------------
+void FixedDisplacedBlock::compute(const double* x, const double* y, const double* z,
+                                  const uint8_t* set, size_t n) {
+
+    ox_.resize(n * kFixedStride);
+    oy_.resize(n * kFixedStride);
+    oz_.resize(n * kFixedStride);
+
+    double* ox = ox_.data();
+    double* oy = oy_.data();
+    double* oz = oz_.data();
+
+    for (size_t i = 0; i < n; ++i, ox += kFixedStride, oy += kFixedStride, oz += kFixedStride) {
+        displace(x[i], y[i], z[i], set[i] != 0, ox, oy, oz,
+                 std::make_index_sequence<kFixedStride>{});
+    }
+}
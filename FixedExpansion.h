@@ -0,0 +1,75 @@
+/*------------------------------------------------------------------------------
+ * File: FixedExpansion.h
+ *
+ * Expansion kernel specialized at compile time for the geometry of
+ * Extensions.h.
+ *
+ * The BLUE and RED displacement lists are constexpr std::arrays, and the
+ * loop over the displacements of a set is unrolled by template expansion,
+ * so every offset is an immediate constant of the generated code and each
+ * point is displaced with no per-set indirection and no gathering by set.
+ *
+ * Used by AddDisplacedPoints whenever no --config file is given; geometry
+ * files go through the runtime kernel (ExpandKernel.h). Both perform the
+ * same IEEE additions with the same offsets, so the output is identical.
+ *
+ *------------------------------------------------------------------------------*/
+
+#ifndef FIXED_EXPANSION_H
+#define FIXED_EXPANSION_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Extensions.h"
+
+/*------------------------------------------------------------------------------
+ * Offsets of one displacement set, column-wise
+ *------------------------------------------------------------------------------*/
+template <size_t N>
+struct FixedSet {
+    std::array<double, N> dx{}, dy{}, dz{};
+
+    static constexpr size_t size() { return N; }
+};
+
+template <size_t N>
+constexpr FixedSet<N> makeFixedSet(const Extension (&list)[N]) {
+    FixedSet<N> s;
+    for (size_t j = 0; j < N; ++j) {
+        s.dx[j] = list[j].dx;
+        s.dy[j] = list[j].dy;
+        s.dz[j] = list[j].dz;
+    }
+    return s;
+}
+
+constexpr auto kFixedBlue = makeFixedSet(extListBlue);
+constexpr auto kFixedRed  = makeFixedSet(extListRed);
+
+// Displacements stored per point: the larger of the two sets
+constexpr size_t kFixedStride = kFixedBlue.size() > kFixedRed.size() ? kFixedBlue.size()
+                                                                     : kFixedRed.size();
+
+/*------------------------------------------------------------------------------
+ * Displaced coordinates of a block of points, built-in geometry only
+ *   set[i] is the index in builtinGeometry(): 0 = BLUE, 1 = RED.
+ *   x(i, j), y(i, j), z(i, j) return displacement j of point i, as for
+ *   DisplacedBlock.
+ *------------------------------------------------------------------------------*/
+class FixedDisplacedBlock {
+public:
+    void compute(const double* x, const double* y, const double* z,
+                 const uint8_t* set, size_t n);
+
+    double x(size_t i, size_t j) const { return ox_[i * kFixedStride + j]; }
+    double y(size_t i, size_t j) const { return oy_[i * kFixedStride + j]; }
+    double z(size_t i, size_t j) const { return oz_[i * kFixedStride + j]; }
+
+private:
+    std::vector<double> ox_, oy_, oz_;      // [point][ext]
+};
+
+#endif // FIXED_EXPANSION_H
@@ -0,0 +1,400 @@
+//------------------------------------------------------------------------------
+// File: Geometry.cpp
+//
+// Built-in and file-based displacement geometry (see Geometry.h).
+//
+// Geometry file format (one statement per line, '#' starts a comment):
+//
+//   NAME = expression          constant, usable in later expressions
+//   fallback = SET             set for points outside all ranges
+//                              (default: the last set)
+//   [SET]                      start a displacement set
+//   ranges = 1-8, 16-21, 42    label number ranges of the current set
+//   ext _1 = dx, dy, dz        displacement with label suffix "_1"
+//   color = blue+1             plot color (ROOT name[+-n] or index)
+//   label = above              number label: above, below or none
+//
+// Constants and fallback go before the first [SET]. Expressions use
+// + - * / ( ), numbers, constants, pi, deg and sqrt/sin/cos/tan/asin/acos/
+// atan/abs, evaluated in double precision exactly as the same expression in
+// Extensions.h: sin and cos are cx::sin/cx::cos (ConstexprMath.h), not the C
+// library's, whose last bit differs for some angles.
+//------------------------------------------------------------------------------
+
+#include "Geometry.h"
+#include "ConstexprMath.h"
+
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+
+//------------------------------------------------------------------------------
+// Geometry
+//------------------------------------------------------------------------------
+void Geometry::build() {
+    classifier = RangeClassifier();
+    for (size_t i = 0; i < sets.size(); ++i) {
+        classifier.add(sets[i].ranges.data(), static_cast<int>(sets[i].ranges.size()),
+                       static_cast<uint8_t>(i));
+    }
+    classifier.build();
+}
+
+//------------------------------------------------------------------------------
+// Plot defaults for set i: BLUE/RED as before, then a fixed palette
+//------------------------------------------------------------------------------
+static const int kDefaultColors[] = {
+    601,    // kBlue+1
+    633,    // kRed+1
+    418,    // kGreen+2
+    617,    // kMagenta+1
+    801,    // kOrange+1
+    434,    // kCyan+2
+    882,    // kViolet+2
+    921     // kGray+1
+};
+
+static void setPlotDefaults(DisplacementSet& s, size_t i) {
+    s.color = kDefaultColors[i % (sizeof(kDefaultColors) / sizeof(kDefaultColors[0]))];
+    s.label = (i % 2 == 0) ? LabelPlacement::Above : LabelPlacement::Below;
+}
+
+static DisplacementSet makeSet(const char* name, size_t index,
+                               const Range* ranges, int nRanges,
+                               const Extension* ext, int nExt) {
+    DisplacementSet s;
+    s.name = name;
+    setPlotDefaults(s, index);
+    s.ranges.assign(ranges, ranges + nRanges);
+    for (int i = 0; i < nExt; ++i) {
+        s.addDisplacement(ext[i].ext, ext[i].dx, ext[i].dy, ext[i].dz);
+    }
+    return s;
+}
+
+Geometry builtinGeometry() {
+    Geometry g;
+    g.sets.push_back(makeSet("BLUE", 0, rangesBlue, numBlueRanges, extListBlue, numExtBlue));
+    g.sets.push_back(makeSet("RED",  1, rangesRed,  numRedRanges,  extListRed,  numExtRed));
+    g.fallback = 1;   // RED
+    g.build();
+    return g;
+}
+
+//------------------------------------------------------------------------------
+// Expression evaluator (recursive descent)
+//   expr   := term   { ('+'|'-') term }
+//   term   := factor { ('*'|'/') factor }
+//   factor := ('+'|'-') factor | number | name | name '(' expr ')' | '(' expr ')'
+//------------------------------------------------------------------------------
+namespace {
+
+// cx::sin/cos reduce by pi/2 in double-double, which stays exact far beyond
+// any angle of a geometry file; larger arguments go to the C library
+constexpr double kCxTrigLimit = 1e6;
+
+class Expression {
+public:
+    Expression(const std::string& text, const std::map<std::string, double>& vars)
+        : p_(text.c_str()), vars_(vars) {}
+
+    // Evaluate the whole text; false (with error()) on a syntax error
+    bool evaluate(double& value) {
+        value = expr();
+        skipBlanks();
+        if (error_.empty() && *p_ != '\0') error_ = "unexpected '" + std::string(p_) + "'";
+        return error_.empty();
+    }
+
+    const std::string& error() const { return error_; }
+
+private:
+    void skipBlanks() {
+        while (*p_ == ' ' || *p_ == '\t') ++p_;
+    }
+
+    double fail(const std::string& msg) {
+        if (error_.empty()) error_ = msg;
+        return 0.0;
+    }
+
+    double expr() {
+        double v = term();
+        for (;;) {
+            skipBlanks();
+            if (*p_ == '+')      { ++p_; v = v + term(); }
+            else if (*p_ == '-') { ++p_; v = v - term(); }
+            else return v;
+        }
+    }
+
+    double term() {
+        double v = factor();
+        for (;;) {
+            skipBlanks();
+            if (*p_ == '*')      { ++p_; v = v * factor(); }
+            else if (*p_ == '/') { ++p_; v = v / factor(); }
+            else return v;
+        }
+    }
+
+    double factor() {
+        skipBlanks();
+        if (*p_ == '+') { ++p_; return +factor(); }
+        if (*p_ == '-') { ++p_; return -factor(); }
+
+        if (*p_ == '(') {
+            ++p_;
+            double v = expr();
+            skipBlanks();
+            if (*p_ != ')') return fail("missing ')'");
+            ++p_;
+            return v;
+        }
+
+        if (std::isdigit(static_cast<unsigned char>(*p_)) || *p_ == '.') {
+            char* end = nullptr;
+            double v = std::strtod(p_, &end);
+            if (end == p_) return fail("bad number");
+            p_ = end;
+            return v;
+        }
+
+        if (std::isalpha(static_cast<unsigned char>(*p_)) || *p_ == '_') {
+            std::string name;
+            while (std::isalnum(static_cast<unsigned char>(*p_)) || *p_ == '_') name += *p_++;
+            skipBlanks();
+            if (*p_ == '(') {
+                ++p_;
+                double a = expr();
+                skipBlanks();
+                if (*p_ != ')') return fail("missing ')'");
+                ++p_;
+                return call(name, a);
+            }
+            auto it = vars_.find(name);
+            if (it == vars_.end()) return fail("unknown name '" + name + "'");
+            return it->second;
+        }
+
+        return fail(*p_ ? "unexpected '" + std::string(1, *p_) + "'" : "missing value");
+    }
+
+    double call(const std::string& f, double a) {
+        if (f == "sqrt") return std::sqrt(a);
+        if (f == "sin")  return std::fabs(a) <= kCxTrigLimit ? cx::sin(a) : std::sin(a);
+        if (f == "cos")  return std::fabs(a) <= kCxTrigLimit ? cx::cos(a) : std::cos(a);
+        if (f == "tan")  return std::tan(a);
+        if (f == "asin") return std::asin(a);
+        if (f == "acos") return std::acos(a);
+        if (f == "atan") return std::atan(a);
+        if (f == "abs")  return std::fabs(a);
+        return fail("unknown function '" + f + "'");
+    }
+
+    const char*                          p_;
+    const std::map<std::string, double>& vars_;
+    std::string                          error_;
+};
+
+//------------------------------------------------------------------------------
+// Small string helpers
+//------------------------------------------------------------------------------
+std::string trim(const std::string& s) {
+    size_t b = s.find_first_not_of(" \t\r");
+    if (b == std::string::npos) return "";
+    size_t e = s.find_last_not_of(" \t\r");
+    return s.substr(b, e - b + 1);
+}
+
+// Split at commas that are not inside parentheses
+std::vector<std::string> splitList(const std::string& s) {
+    std::vector<std::string> items;
+    std::string cur;
+    int depth = 0;
+    for (char c : s) {
+        if (c == '(') ++depth;
+        if (c == ')') --depth;
+        if (c == ',' && depth == 0) {
+            items.push_back(trim(cur));
+            cur.clear();
+        } else {
+            cur += c;
+        }
+    }
+    items.push_back(trim(cur));
+    return items;
+}
+
+bool parseInt(const std::string& s, int& v) {
+    if (s.empty()) return false;
+    char* end = nullptr;
+    long n = std::strtol(s.c_str(), &end, 10);
+    if (*end != '\0' || n < 0 || n > 2147483647L) return false;
+    v = static_cast<int>(n);
+    return true;
+}
+
+// "a" or "a-b"
+bool parseRange(const std::string& s, Range& r) {
+    size_t dash = s.find('-', 1);
+    if (dash == std::string::npos) {
+        if (!parseInt(s, r.lo)) return false;
+        r.hi = r.lo;
+        return true;
+    }
+    return parseInt(trim(s.substr(0, dash)), r.lo) &&
+           parseInt(trim(s.substr(dash + 1)), r.hi) && r.lo <= r.hi;
+}
+
+// ROOT color: index, or name with optional offset ("blue+1", "gray-2")
+bool parseColor(const std::string& s, int& color) {
+    static const std::map<std::string, int> names = {
+        {"white",  0}, {"black",  1}, {"gray",  920}, {"red",   632},
+        {"green", 416}, {"blue", 600}, {"yellow", 400}, {"magenta", 616},
+        {"cyan",  432}, {"orange", 800}, {"spring", 820}, {"teal", 840},
+        {"azure", 860}, {"violet", 880}, {"pink", 900}
+    };
+    if (parseInt(s, color)) return true;
+
+    size_t op = s.find_first_of("+-");
+    std::string name = trim(s.substr(0, op));
+    auto it = names.find(name);
+    if (it == names.end()) return false;
+    color = it->second;
+    if (op == std::string::npos) return true;
+
+    int offset;
+    if (!parseInt(trim(s.substr(op + 1)), offset)) return false;
+    color += (s[op] == '+') ? offset : -offset;
+    return true;
+}
+
+} // namespace
+
+//------------------------------------------------------------------------------
+// Geometry file reader
+//------------------------------------------------------------------------------
+bool loadGeometry(const std::string& fileName, Geometry& geometry) {
+
+    std::ifstream in(fileName);
+    if (!in) {
+        std::cerr << "Error opening geometry file " << fileName << "\n";
+        return false;
+    }
+
+    std::map<std::string, double> vars = { {"pi", PI}, {"deg", deg} };
+    std::string fallbackName;
+    Geometry g;
+
+    std::string line;
+    int lineNo = 0;
+    auto error = [&](const std::string& msg) {
+        std::cerr << fileName << ":" << lineNo << ": " << msg << "\n";
+        return false;
+    };
+
+    while (std::getline(in, line)) {
+        ++lineNo;
+        size_t hash = line.find('#');
+        if (hash != std::string::npos) line.erase(hash);
+        line = trim(line);
+        if (line.empty()) continue;
+
+        // [SET]
+        if (line.front() == '[') {
+            if (line.back() != ']') return error("missing ']'");
+            std::string name = trim(line.substr(1, line.size() - 2));
+            if (name.empty()) return error("empty set name");
+            for (const auto& s : g.sets) {
+                if (s.name == name) return error("duplicate set '" + name + "'");
+            }
+            if (g.sets.size() >= Geometry::kNone) return error("too many sets");
+            g.sets.emplace_back();
+            g.sets.back().name = name;
+            setPlotDefaults(g.sets.back(), g.sets.size() - 1);
+            continue;
+        }
+
+        size_t eq = line.find('=');
+        if (eq == std::string::npos) return error("expected 'key = value'");
+        std::string key   = trim(line.substr(0, eq));
+        std::string value = trim(line.substr(eq + 1));
+
+        if (g.sets.empty()) {
+            // Top level: fallback or constant
+            if (key == "fallback") {
+                fallbackName = value;
+                continue;
+            }
+            if (key.empty() || !(std::isalpha(static_cast<unsigned char>(key[0])) || key[0] == '_')) {
+                return error("bad constant name '" + key + "'");
+            }
+            double v;
+            Expression e(value, vars);
+            if (!e.evaluate(v)) return error(e.error());
+            vars[key] = v;
+            continue;
+        }
+
+        DisplacementSet& set = g.sets.back();
+
+        if (key == "ranges") {
+            for (const std::string& item : splitList(value)) {
+                Range r;
+                if (!parseRange(item, r)) return error("bad range '" + item + "'");
+                set.ranges.push_back(r);
+            }
+        } else if (key.compare(0, 3, "ext") == 0 &&
+                   (key.size() == 3 || key[3] == ' ' || key[3] == '\t')) {
+            std::string suffix = trim(key.substr(3));
+            if (suffix.empty()) return error("missing label suffix after 'ext'");
+            std::vector<std::string> items = splitList(value);
+            if (items.size() != 3) return error("expected dx, dy, dz");
+            double d[3];
+            for (int i = 0; i < 3; ++i) {
+                Expression e(items[i], vars);
+                if (!e.evaluate(d[i])) return error(e.error());
+            }
+            set.addDisplacement(suffix, d[0], d[1], d[2]);
+        } else if (key == "color") {
+            if (!parseColor(value, set.color)) return error("bad color '" + value + "'");
+        } else if (key == "label") {
+            if (value == "above") {
+                set.label = LabelPlacement::Above;
+            } else if (value == "below") {
+                set.label = LabelPlacement::Below;
+            } else if (value == "none") {
+                set.label = LabelPlacement::None;
+            } else {
+                return error("bad label placement '" + value + "'");
+            }
+        } else {
+            return error("unknown key '" + key + "' in set " + set.name);
+        }
+    }
+
+    if (g.sets.empty()) {
+        std::cerr << fileName << ": no displacement sets defined\n";
+        return false;
+    }
+
+    g.fallback = static_cast<int>(g.sets.size()) - 1;
+    if (!fallbackName.empty()) {
+        g.fallback = -1;
+        for (size_t i = 0; i < g.sets.size(); ++i) {
+            if (g.sets[i].name == fallbackName) g.fallback = static_cast<int>(i);
+        }
+        if (g.fallback < 0) {
+            std::cerr << fileName << ": unknown fallback set '" << fallbackName << "'\n";
+            return false;
+        }
+    }
+
+    g.build();
+    geometry = std::move(g);
+    return true;
+}
@@ -0,0 +1,96 @@
+/*------------------------------------------------------------------------------
+ * File: Geometry.h
+ *
+ * Displacement geometry used by AddDisplacedPoints at run time.
+ *
+ * A Geometry is a list of any number of named displacement sets (up to 255).
+ * Each set has the label number ranges that select it, the list of
+ * displacements (label suffix and dx,dy,dz) applied to its points, and how
+ * its originals are drawn (color, label placement). Sets listed first take
+ * precedence where ranges overlap; points outside every range use the
+ * fallback set. Selecting a set is one table lookup whatever the number of
+ * sets.
+ *
+ * The geometry comes either from Extensions.h (builtinGeometry(), the
+ * default) or from a text file given with --config (loadGeometry()), so
+ * geometry variants can be run without rebuilding. See default_geometry.txt
+ * for the file format; it reproduces Extensions.h exactly.
+ *
+ *------------------------------------------------------------------------------*/
+
+#ifndef GEOMETRY_H
+#define GEOMETRY_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Extensions.h"
+#include "Classifier.h"
+
+/*------------------------------------------------------------------------------
+ * Where the plot draws the point number of an original point
+ *------------------------------------------------------------------------------*/
+enum class LabelPlacement { Above, Below, None };
+
+/*------------------------------------------------------------------------------
+ * One named displacement set
+ *   Displacements are stored column-wise: ext[j] is the label suffix and
+ *   dx[j],dy[j],dz[j] the offsets (mm) of displacement j, so the expansion
+ *   kernel can read each coordinate as one contiguous array.
+ *   color → ROOT color index of its original points in the plot
+ *------------------------------------------------------------------------------*/
+struct DisplacementSet {
+    std::string              name;
+    std::vector<Range>       ranges;
+    std::vector<std::string> ext;
+    std::vector<double>      dx, dy, dz;
+    int                      color = 1;      // kBlack
+    LabelPlacement           label = LabelPlacement::Above;
+
+    void addDisplacement(const std::string& suffix, double x, double y, double z) {
+        ext.push_back(suffix);
+        dx.push_back(x);
+        dy.push_back(y);
+        dz.push_back(z);
+    }
+
+    size_t size() const { return ext.size(); }
+};
+
+/*------------------------------------------------------------------------------
+ * All displacement sets plus the number → set lookup
+ *------------------------------------------------------------------------------*/
+struct Geometry {
+    static constexpr uint8_t kNone = RangeClassifier::kNone;
+
+    std::vector<DisplacementSet> sets;
+    int                          fallback = -1;   // set for unmatched points
+
+    // Build the range lookup; call once after the sets are filled in
+    void build();
+
+    // Index of the set whose ranges contain number, kNone if there is none
+    uint8_t classify(int number) const { return classifier.classify(number); }
+
+    // Set used for a point with classification cls
+    uint8_t selectIndex(uint8_t cls) const {
+        return cls == kNone ? static_cast<uint8_t>(fallback) : cls;
+    }
+    const DisplacementSet& select(uint8_t cls) const { return sets[selectIndex(cls)]; }
+
+    RangeClassifier classifier;
+};
+
+/*------------------------------------------------------------------------------
+ * BLUE and RED sets from Extensions.h (fallback RED)
+ *------------------------------------------------------------------------------*/
+Geometry builtinGeometry();
+
+/*------------------------------------------------------------------------------
+ * Read a geometry file. On error prints "file:line: message" to stderr and
+ * returns false.
+ *------------------------------------------------------------------------------*/
+bool loadGeometry(const std::string& fileName, Geometry& geometry);
+
+#endif // GEOMETRY_H
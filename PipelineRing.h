@@ -0,0 +1,105 @@
+/*------------------------------------------------------------------------------
+ * File: PipelineRing.h
+ *
+ * Bounded ring of slots connecting the stages of AddDisplacedPoints
+ * --pipeline: one reader fills slots in sequence, any number of expander
+ * threads process them, and one writer consumes them in sequence order.
+ *
+ * Every slot has an atomic turn, seq * kStages + stage, telling which
+ * sequence number it holds and how far that has got. Passing a slot on is a
+ * single release store; waiting is a load of the turn, so no lock is taken
+ * (the scheme of Vyukov's bounded MPMC queue). Slot seq % size() is reused
+ * for seq + size() only after the writer has released seq, so at most
+ * size() slots are in flight and a reader that runs ahead of the writer
+ * waits (backpressure).
+ *
+ * A waiting thread spins briefly, then yields, then sleeps in steps of
+ * 50 µs, so a stage blocked on the disk costs the others little CPU.
+ *
+ *------------------------------------------------------------------------------*/
+
+#ifndef PIPELINE_RING_H
+#define PIPELINE_RING_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <thread>
+#include <vector>
+
+enum class SlotStage : unsigned { Free, Filled, Processed };
+
+template <class Slot>
+class PipelineRing {
+public:
+    static constexpr uint64_t kStages = 3;
+
+    PipelineRing(size_t n, const Slot& proto)
+        : slots_(n, proto), turns_(new Turn[n]) { reset(); }
+
+    size_t size() const { return slots_.size(); }
+
+    Slot& operator[](uint64_t seq) { return slots_[seq % size()]; }
+
+    // All slots free for sequence numbers 0 .. size()-1 (no thread may be
+    // using the ring)
+    void reset() {
+        for (size_t i = 0; i < size(); ++i) {
+            turns_[i].turn.store(i * kStages, std::memory_order_relaxed);
+        }
+        end_.store(std::numeric_limits<uint64_t>::max(), std::memory_order_relaxed);
+        aborted_.store(false, std::memory_order_release);
+    }
+
+    // Wait until the slot of seq has reached stage; false if the ring was
+    // aborted or closed before seq
+    bool wait(uint64_t seq, SlotStage stage) const {
+        const uint64_t want = seq * kStages + static_cast<uint64_t>(stage);
+        const std::atomic<uint64_t>& turn = turns_[seq % size()].turn;
+        for (unsigned spin = 0; turn.load(std::memory_order_acquire) < want; ++spin) {
+            if (aborted_.load(std::memory_order_relaxed)) return false;
+            if (seq >= end_.load(std::memory_order_acquire)) return false;
+            if (spin < 64) continue;
+            if (spin < 256) {
+                std::this_thread::yield();
+            } else {
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+        }
+        return true;
+    }
+
+    // Hand the slot of seq to the next stage
+    void advance(uint64_t seq, SlotStage stage) {
+        turns_[seq % size()].turn.store(seq * kStages + static_cast<uint64_t>(stage),
+                                        std::memory_order_release);
+    }
+
+    // Writer done with seq: the slot becomes free for seq + size()
+    void release(uint64_t seq) {
+        advance(seq + size(), SlotStage::Free);
+    }
+
+    // No sequence number >= count will be filled
+    void close(uint64_t count) { end_.store(count, std::memory_order_release); }
+
+    // Stop every stage (waits return false)
+    void abort() { aborted_.store(true, std::memory_order_release); }
+    bool aborted() const { return aborted_.load(std::memory_order_acquire); }
+
+private:
+    // One cache line per turn, so stages on different slots do not contend
+    struct alignas(64) Turn {
+        std::atomic<uint64_t> turn{0};
+    };
+
+    std::vector<Slot>       slots_;
+    std::unique_ptr<Turn[]> turns_;
+    std::atomic<uint64_t>   end_{0};
+    std::atomic<bool>       aborted_{false};
+};
+
+#endif // PIPELINE_RING_H
@@ -0,0 +1,291 @@
+//------------------------------------------------------------------------------
+// File: Plot.cpp
+//
+// ROOT canvas for AddDisplacedPoints (see Plot.h).
+//
+// Compiled without ROOT when ADP_NO_ROOT is defined ("make ROOT=0").
+//------------------------------------------------------------------------------
+
+#include "Plot.h"
+
+#include <iostream>
+
+//------------------------------------------------------------------------------
+// Summary of the data reduction (same with and without ROOT)
+//------------------------------------------------------------------------------
+void printPlotSummary(const PlotData& plotData, const PlotOptions& options) {
+    const PlotPointSet& dis = plotData.displaced;
+    if (dis.decimated()) {
+        std::cout << "Plot: " << dis.total() << " displaced points drawn as "
+                  << (options.density ? "density of " : "") << dis.size() << " cells\n";
+    }
+    if (plotData.labelsSuppressed) {
+        std::cout << "Plot: point numbers not drawn (more than " << options.maxLabels
+                  << " original points)\n";
+    }
+}
+
+#ifndef ADP_NO_ROOT
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// ROOT includes
+#include "TApplication.h"
+#include "TCanvas.h"
+#include "TGraph.h"
+#include "TH2F.h"
+#include "TLatex.h"
+#include "TStyle.h"
+#include "TColor.h"
+#include "TROOT.h"
+#include "TFile.h"
+
+bool plotAvailable() {
+    return true;
+}
+
+//------------------------------------------------------------------------------
+// Density histogram of a decimated point set, binned over its extent
+//------------------------------------------------------------------------------
+static TH2F* densityHistogram(const PlotPointSet& p) {
+    const int kBins = 400;
+
+    const PlotBounds& b = p.bounds();
+    double x0 = b.xmin, x1 = b.xmax + p.cellSize();
+    double y0 = b.ymin, y1 = b.ymax + p.cellSize();
+
+    TH2F* h = new TH2F("hDisplaced", "", kBins, x0, x1, kBins, y0, y1);
+    h->SetDirectory(nullptr);
+    h->SetStats(false);
+    for (size_t i = 0; i < p.size(); ++i) {
+        h->Fill(p.x()[i], p.y()[i], static_cast<double>(p.weight(i)));
+    }
+    return h;
+}
+
+//------------------------------------------------------------------------------
+// Build the canvas from the collected plot data
+//------------------------------------------------------------------------------
+static TCanvas* buildCanvas(const PlotData& plotData, const Geometry& geometry,
+                            const PlotOptions& options) {
+
+    TCanvas* c = new TCanvas("c", "AddDisplacedPoints", 900, 900);
+    c->SetGrid();
+
+    const PlotPointSet& dis = plotData.displaced;
+
+    // Axes: a frame around the bounds of all points, tracked while they
+    // were collected, with a 5% margin (at least 1 mm, and room for the
+    // point numbers drawn 30 above/below the originals)
+    PlotBounds b = plotData.bounds();
+    if (b.empty()) b.add(0.0f, 0.0f);
+    double mx = std::max(0.05 * (double(b.xmax) - b.xmin), 1.0);
+    double my = std::max(0.05 * (double(b.ymax) - b.ymin), 1.0);
+    if (!plotData.labels.empty()) my = std::max(my, 40.0);
+    c->DrawFrame(b.xmin - mx, b.ymin - my, b.xmax + mx, b.ymax + my);
+
+    // Originals, one graph per displacement set
+    for (size_t s = 0; s < plotData.originals.size() && s < geometry.sets.size(); ++s) {
+        const PlotPointSet& o = plotData.originals[s];
+        TGraph* g = new TGraph(static_cast<int>(o.size()), o.x().data(), o.y().data());
+        g->SetName(("g" + geometry.sets[s].name).c_str());
+        g->SetMarkerColor(geometry.sets[s].color);
+        g->SetMarkerStyle(20);
+        g->SetMarkerSize(2.5);
+        g->Draw("P SAME");
+    }
+
+    // Displaced points: markers, or their density once decimated
+    if (dis.decimated() && options.density) {
+        densityHistogram(dis)->Draw("COL SAME");
+    } else {
+        TGraph* gDis = new TGraph(static_cast<int>(dis.size()), dis.x().data(), dis.y().data());
+        gDis->SetMarkerColor(kBlack);
+        gDis->SetMarkerStyle(20);
+        gDis->SetMarkerSize(0.8);
+        gDis->Draw("P SAME");
+    }
+
+    //--------------------------------------------------------------------------
+    // Draw labels for original points
+    //--------------------------------------------------------------------------
+    for (const PlotLabel& l : plotData.labels) {
+
+        LabelPlacement where = geometry.sets[l.set].label;
+        if (where == LabelPlacement::None) continue;
+
+        bool above = (where == LabelPlacement::Above);
+        double yLabel = above ? l.y + 30.0      // above
+                              : l.y - 30.0;     // below
+        int align = above ? 21 : 23;            // center horizontally
+
+        TLatex* tl = new TLatex(l.x, yLabel, Form("%d", l.number));
+        tl->SetTextColor(kBlack);
+        tl->SetTextSize(0.015);
+        tl->SetTextAlign(align);
+        tl->Draw("SAME");
+    }
+
+    c->Modified();
+    c->Update();
+    return c;
+}
+
+//------------------------------------------------------------------------------
+// PlotFiles
+//------------------------------------------------------------------------------
+PlotFiles::~PlotFiles() {
+    wait(nullptr);
+}
+
+bool PlotFiles::start(const PlotData& plotData, const Geometry& geometry,
+                      const PlotOptions& options) {
+
+    if (!options.anyFile()) return true;
+    options_ = options;
+
+    int fds[2];
+    if (pipe(fds) != 0) {
+        std::cerr << "Error creating pipe for the plot files\n";
+        return false;
+    }
+
+    // Unwritten stream buffers would otherwise be written by both processes
+    std::cout.flush();
+    std::cerr.flush();
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        std::cerr << "Error starting the plot file writer\n";
+        close(fds[0]);
+        close(fds[1]);
+        return false;
+    }
+
+    if (pid == 0) {
+        // Child: batch-mode ROOT, draw, save, send the times, exit
+        close(fds[0]);
+        StageTimes times;
+        StageTimer timer(&times);
+
+        gROOT->SetBatch(true);
+        TCanvas* c = buildCanvas(plotData, geometry, options);
+        timer.lap(Stage::Plot);
+
+        // TCanvas::Print() reports no failure: remove any old file first and
+        // check that a non-empty one was written
+        bool ok = true;
+        if (!options.pngFile.empty()) {
+            unlink(options.pngFile.c_str());
+            c->Print(options.pngFile.c_str());
+            struct stat st;
+            if (stat(options.pngFile.c_str(), &st) != 0 || st.st_size == 0) {
+                std::cerr << "Error writing PNG file " << options.pngFile << "\n";
+                ok = false;
+            }
+            timer.lap(Stage::PlotPng);
+        }
+        if (!options.rootFile.empty()) {
+            TFile f(options.rootFile.c_str(), "RECREATE");
+            if (f.IsZombie()) {
+                std::cerr << "Error writing ROOT file " << options.rootFile << "\n";
+                ok = false;
+            } else {
+                c->Write();
+            }
+            f.Close();
+            timer.lap(Stage::PlotRoot);
+        }
+        std::cerr.flush();
+
+        ssize_t n = write(fds[1], &times, sizeof(times));
+        (void)n;
+        close(fds[1]);
+        _exit(ok ? 0 : 1);
+    }
+
+    close(fds[1]);
+    pid_ = pid;
+    fd_  = fds[0];
+    return true;
+}
+
+bool PlotFiles::wait(RunStats* stats) {
+    if (pid_ < 0) return true;
+
+    StageTimes times;
+    size_t got = 0;
+    char* p = reinterpret_cast<char*>(&times);
+    while (got < sizeof(times)) {
+        ssize_t n = read(fd_, p + got, sizeof(times) - got);
+        if (n <= 0) break;
+        got += static_cast<size_t>(n);
+    }
+    close(fd_);
+    fd_ = -1;
+
+    int status = 0;
+    pid_t pid = pid_;
+    pid_ = -1;
+    if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        std::cerr << "Error writing the plot files\n";
+        return false;
+    }
+
+    if (stats && got == sizeof(times)) stats->times.add(times);
+    if (!options_.pngFile.empty())  std::cout << "Wrote " << options_.pngFile << "\n";
+    if (!options_.rootFile.empty()) std::cout << "Wrote " << options_.rootFile << "\n";
+    return true;
+}
+
+//------------------------------------------------------------------------------
+// PlotWindow
+//------------------------------------------------------------------------------
+PlotWindow::~PlotWindow() {
+    delete app_;
+}
+
+void PlotWindow::draw(const PlotData& plotData, const Geometry& geometry,
+                      const PlotOptions& options) {
+    int dummy = 0;
+    app_ = new TApplication("app", &dummy, nullptr);
+    buildCanvas(plotData, geometry, options);
+}
+
+void PlotWindow::run() {
+    if (app_) app_->Run();
+}
+
+#else // ADP_NO_ROOT
+
+bool plotAvailable() {
+    return false;
+}
+
+PlotFiles::~PlotFiles() {}
+
+bool PlotFiles::start(const PlotData&, const Geometry&, const PlotOptions& options) {
+    if (!options.anyFile()) return true;
+    std::cerr << "Plotting not available (built without ROOT)\n";
+    return false;
+}
+
+bool PlotFiles::wait(RunStats*) {
+    return true;
+}
+
+PlotWindow::~PlotWindow() {}
+
+void PlotWindow::draw(const PlotData&, const Geometry&, const PlotOptions&) {
+    std::cerr << "Plotting not available (built without ROOT)\n";
+}
+
+void PlotWindow::run() {}
+
+#endif // ADP_NO_ROOT
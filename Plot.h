@@ -0,0 +1,110 @@
+/*------------------------------------------------------------------------------
+ * File: Plot.h
+ *
+ * ROOT plotting for AddDisplacedPoints.
+ *
+ * The expander fills a PlotData record while it writes the CSV, which is
+ * then turned into a canvas (one TGraph per displacement set, colored and
+ * labelled as the Geometry says):
+ *   • PlotFiles  — renders the canvas in a forked child process and saves
+ *                  the PNG and/or ROOT file there, so the files are written
+ *                  while the parent finishes the CSV and opens the window
+ *   • PlotWindow — the interactive ROOT application
+ * PlotData stays bounded for any input size (PlotOptions), so drawing and
+ * saving take bounded time as well.
+ *
+ * This is the only part of the program that uses ROOT. Building with
+ * "make ROOT=0" defines ADP_NO_ROOT, compiles Plot.cpp without ROOT and
+ * produces a plain CSV expander (plotAvailable() then returns false).
+ *
+ *------------------------------------------------------------------------------*/
+
+#ifndef PLOT_H
+#define PLOT_H
+
+#include <cstddef>
+#include <string>
+#include <sys/types.h>
+
+#include "Geometry.h"
+#include "PlotData.h"
+#include "Stats.h"
+
+class TApplication;
+
+/*------------------------------------------------------------------------------
+ * What is plotted and how
+ *   maxPoints → above this many points a graph is decimated (PlotData.h)
+ *   maxLabels → above this many original points no numbers are drawn
+ *   density   → draw decimated displaced points as a TH2 density instead of
+ *               markers
+ *   pngFile, rootFile → files to save ("" = not written)
+ *   window    → show the canvas and run the ROOT event loop
+ *------------------------------------------------------------------------------*/
+struct PlotOptions {
+    size_t      maxPoints = 200000;
+    size_t      maxLabels = 2000;
+    bool        density   = true;
+    std::string pngFile   = "AddDisplacedPoints.png";
+    std::string rootFile  = "AddDisplacedPoints.root";
+    bool        window    = true;
+
+    bool anyFile() const { return !pngFile.empty() || !rootFile.empty(); }
+};
+
+/*------------------------------------------------------------------------------
+ * true if this build contains the ROOT plotting code
+ *------------------------------------------------------------------------------*/
+bool plotAvailable();
+
+/*------------------------------------------------------------------------------
+ * Print on stdout how the plot data was reduced (decimation, labels)
+ *------------------------------------------------------------------------------*/
+void printPlotSummary(const PlotData& plotData, const PlotOptions& options);
+
+/*------------------------------------------------------------------------------
+ * PNG/ROOT files written by a child process
+ *   start() forks a child that draws the canvas in batch mode and saves the
+ *   files of options (nothing to do if there are none). It is called once
+ *   the plot data is complete, i.e. after the output has been written, so
+ *   the child runs alongside closing the output and drawing the window
+ *   only. wait() waits for it,
+ *   adds its drawing/saving times to stats and returns false if it failed.
+ *------------------------------------------------------------------------------*/
+class PlotFiles {
+public:
+    PlotFiles() = default;
+    ~PlotFiles();
+
+    PlotFiles(const PlotFiles&) = delete;
+    PlotFiles& operator=(const PlotFiles&) = delete;
+
+    bool start(const PlotData& plotData, const Geometry& geometry, const PlotOptions& options);
+    bool wait(RunStats* stats);
+
+private:
+    pid_t       pid_ = -1;
+    int         fd_  = -1;      // child → parent: its StageTimes
+    PlotOptions options_;
+};
+
+/*------------------------------------------------------------------------------
+ * Interactive canvas: draw() creates the ROOT application and the canvas,
+ * run() runs the event loop until the window is closed
+ *------------------------------------------------------------------------------*/
+class PlotWindow {
+public:
+    PlotWindow() = default;
+    ~PlotWindow();
+
+    PlotWindow(const PlotWindow&) = delete;
+    PlotWindow& operator=(const PlotWindow&) = delete;
+
+    void draw(const PlotData& plotData, const Geometry& geometry, const PlotOptions& options);
+    void run();
+
+private:
+    TApplication* app_ = nullptr;
+};
+
+#endif // PLOT_H
@@ -0,0 +1,147 @@
+//------------------------------------------------------------------------------
+// File: PlotData.cpp
+//
+// Bounded plot data (see PlotData.h).
+//------------------------------------------------------------------------------
+
+#include "PlotData.h"
+
+#include <algorithm>
+#include <cmath>
+
+//------------------------------------------------------------------------------
+// PlotPointSet
+//------------------------------------------------------------------------------
+uint64_t PlotPointSet::cellKey(float x, float y) const {
+    auto cell = [this](double v) {
+        double c = std::floor(v / cellSize_);
+        c = std::min(std::max(c, -2147483648.0), 2147483647.0);
+        return static_cast<uint32_t>(static_cast<int32_t>(c));
+    };
+    return (static_cast<uint64_t>(cell(x)) << 32) | cell(y);
+}
+
+void PlotPointSet::addToCell(float x, float y, uint64_t w) {
+    uint64_t key = cellKey(x, y);
+    auto it = cells_.find(key);
+    if (it != cells_.end()) {
+        weight_[it->second] += w;
+        return;
+    }
+    cells_.emplace(key, static_cast<uint32_t>(x_.size()));
+    x_.push_back(x);
+    y_.push_back(y);
+    weight_.push_back(w);
+    if (cells_.size() > limit_) rebin(cellSize_ * 2);
+}
+
+// Re-bin the current points (or representatives) on a grid of cellSize,
+// doubling it until at most half the limit is used, to leave room for more
+void PlotPointSet::rebin(double cellSize) {
+    std::vector<float>    x, y;
+    std::vector<uint64_t> w;
+    x.swap(x_);
+    y.swap(y_);
+    w.swap(weight_);
+    if (w.empty()) w.assign(x.size(), 1);
+
+    for (;;) {
+        cellSize_ = cellSize;
+        cells_.clear();
+        x_.clear();
+        y_.clear();
+        weight_.clear();
+        for (size_t i = 0; i < x.size(); ++i) {
+            uint64_t key = cellKey(x[i], y[i]);
+            auto it = cells_.find(key);
+            if (it != cells_.end()) {
+                weight_[it->second] += w[i];
+            } else {
+                cells_.emplace(key, static_cast<uint32_t>(x_.size()));
+                x_.push_back(x[i]);
+                y_.push_back(y[i]);
+                weight_.push_back(w[i]);
+            }
+        }
+        if (cells_.size() <= limit_ / 2 || cells_.size() <= 1) break;
+        cellSize *= 2;
+    }
+}
+
+void PlotPointSet::decimate() {
+    double extent = std::max(double(bounds_.xmax) - bounds_.xmin,
+                             double(bounds_.ymax) - bounds_.ymin);
+
+    // A grid of about limit cells over the bounding square
+    double cellSize = extent / std::sqrt(static_cast<double>(limit_));
+    if (!(cellSize > 0) || !std::isfinite(cellSize)) cellSize = 1.0;
+    rebin(cellSize);
+}
+
+void PlotPointSet::append(const PlotPointSet& o) {
+    bounds_.add(o.bounds_);
+    if (!decimated() && !o.decimated()) {
+        x_.insert(x_.end(), o.x_.begin(), o.x_.end());
+        y_.insert(y_.end(), o.y_.begin(), o.y_.end());
+        total_ += o.total_;
+        if (limit_ && x_.size() > limit_) decimate();
+        return;
+    }
+
+    if (!decimated()) {
+        if (!limit_) limit_ = o.limit_;
+        decimate();
+    }
+    for (size_t i = 0; i < o.size(); ++i) {
+        addToCell(o.x_[i], o.y_[i], o.weight(i));
+    }
+    total_ += o.total_;
+}
+
+void PlotPointSet::clear() {
+    total_    = 0;
+    bounds_   = PlotBounds();
+    cellSize_ = 0;
+    x_.clear();
+    y_.clear();
+    weight_.clear();
+    cells_.clear();
+}
+
+//------------------------------------------------------------------------------
+// PlotData
+//------------------------------------------------------------------------------
+PlotBounds PlotData::bounds() const {
+    PlotBounds b = displaced.bounds();
+    for (const PlotPointSet& o : originals) b.add(o.bounds());
+    return b;
+}
+
+void PlotData::setLimits(size_t maxPoints, size_t maxLabels) {
+    for (PlotPointSet& o : originals) o.setLimit(maxPoints);
+    displaced.setLimit(maxPoints);
+    maxLabels_ = maxLabels;
+}
+
+void PlotData::append(const PlotData& o) {
+    if (originals.size() < o.originals.size()) originals.resize(o.originals.size());
+    for (size_t s = 0; s < o.originals.size(); ++s) {
+        originals[s].append(o.originals[s]);
+    }
+    displaced.append(o.displaced);
+
+    if (o.labelsSuppressed) labelsSuppressed = true;
+    if (maxLabels_ && labels.size() + o.labels.size() > maxLabels_) labelsSuppressed = true;
+    if (labelsSuppressed) {
+        labels.clear();
+    } else {
+        labels.insert(labels.end(), o.labels.begin(), o.labels.end());
+    }
+}
+
+void PlotData::clear() {
+    for (auto& o : originals) o.clear();
+    displaced.clear();
+    labels.clear();
+    labelsSuppressed = false;
+}
@@ -0,0 +1,156 @@
+/*------------------------------------------------------------------------------
+ * File: PlotData.h
+ *
+ * Data kept for the AddDisplacedPoints plot: only what the canvas needs,
+ * never the full points, and bounded in size whatever the input size.
+ *
+ * Contents:
+ *   • PlotLabel    — a point number drawn next to an original point
+ *   • PlotPointSet — points of one graph; exact up to a limit, then reduced
+ *                    to one weighted representative per grid cell
+ *   • PlotData     — originals per displacement set, displaced points and
+ *                    labels
+ *
+ * Decimation: once a PlotPointSet holds more than its limit, the points are
+ * binned on a square grid sized from their extent, and each occupied cell
+ * keeps its first point and the number of points that fell into it. When
+ * the number of cells exceeds the limit again the cell size is doubled.
+ * The representatives are drawn as markers, or the weights as a density
+ * histogram (Plot.cpp).
+ *
+ * Coordinates are stored once, as float (ample for a plot, half the memory
+ * of double), and every set keeps the running bounds of all points added,
+ * so the canvas frame needs no extra copy of the points.
+ *
+ *------------------------------------------------------------------------------*/
+
+#ifndef PLOT_DATA_H
+#define PLOT_DATA_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+/*------------------------------------------------------------------------------
+ * Point number drawn next to an original point
+ *------------------------------------------------------------------------------*/
+struct PlotLabel {
+    float   x;
+    float   y;
+    int     number;
+    uint8_t set;        // index into Geometry::sets
+};
+
+/*------------------------------------------------------------------------------
+ * Bounding box of a set of points (empty until the first point)
+ *------------------------------------------------------------------------------*/
+struct PlotBounds {
+    float xmin =  std::numeric_limits<float>::infinity();
+    float xmax = -std::numeric_limits<float>::infinity();
+    float ymin =  std::numeric_limits<float>::infinity();
+    float ymax = -std::numeric_limits<float>::infinity();
+
+    bool empty() const { return xmin > xmax; }
+
+    void add(float x, float y) {
+        xmin = std::min(xmin, x);
+        xmax = std::max(xmax, x);
+        ymin = std::min(ymin, y);
+        ymax = std::max(ymax, y);
+    }
+
+    void add(const PlotBounds& o) {
+        xmin = std::min(xmin, o.xmin);
+        xmax = std::max(xmax, o.xmax);
+        ymin = std::min(ymin, o.ymin);
+        ymax = std::max(ymax, o.ymax);
+    }
+};
+
+/*------------------------------------------------------------------------------
+ * Points of one graph
+ *   x()[i], y()[i] is a point, or with decimated() the representative of
+ *   weight(i) points. total() counts every point added.
+ *------------------------------------------------------------------------------*/
+class PlotPointSet {
+public:
+    // Keep at most maxPoints points (0 = no limit); set before adding
+    void setLimit(size_t maxPoints) { limit_ = maxPoints; }
+
+    void add(double xd, double yd) {
+        float x = static_cast<float>(xd);
+        float y = static_cast<float>(yd);
+        ++total_;
+        bounds_.add(x, y);
+        if (cellSize_ > 0) {
+            addToCell(x, y, 1);
+            return;
+        }
+        x_.push_back(x);
+        y_.push_back(y);
+        if (limit_ && x_.size() > limit_) decimate();
+    }
+
+    // Add all points of another set (used to merge per-batch data)
+    void append(const PlotPointSet& o);
+
+    void clear();
+
+    size_t   size()      const { return x_.size(); }
+    uint64_t total()     const { return total_; }
+    bool     decimated() const { return cellSize_ > 0; }
+    double   cellSize()  const { return cellSize_; }
+
+    const PlotBounds&         bounds() const { return bounds_; }
+    const std::vector<float>& x() const { return x_; }
+    const std::vector<float>& y() const { return y_; }
+    uint64_t weight(size_t i) const { return weight_.empty() ? 1 : weight_[i]; }
+
+private:
+    void decimate();
+    void addToCell(float x, float y, uint64_t w);
+    void rebin(double cellSize);
+    uint64_t cellKey(float x, float y) const;
+
+    size_t                                 limit_    = 0;
+    uint64_t                               total_    = 0;
+    double                                 cellSize_ = 0;   // 0: exact points
+    PlotBounds                             bounds_;         // of all points added
+    std::vector<float>                     x_, y_;
+    std::vector<uint64_t>                  weight_;         // decimated only
+    std::unordered_map<uint64_t, uint32_t> cells_;          // cell → index
+};
+
+/*------------------------------------------------------------------------------
+ * Everything the canvas needs
+ *   Labels beyond maxLabels are not kept: once there would be more, all are
+ *   dropped and labelsSuppressed is set, since thousands of overlapping
+ *   numbers are unreadable and each one is a ROOT object.
+ *------------------------------------------------------------------------------*/
+struct PlotData {
+    std::vector<PlotPointSet> originals;  // per displacement set
+    PlotPointSet              displaced;
+    std::vector<PlotLabel>    labels;     // point numbers drawn next to originals
+    bool                      labelsSuppressed = false;
+
+    explicit PlotData(size_t nSets = 0) : originals(nSets) {}
+
+    // Bounds of all originals and displaced points
+    PlotBounds bounds() const;
+
+    // Bound the data (0 = no limit): points per graph and number of labels
+    void setLimits(size_t maxPoints, size_t maxLabels);
+
+    // Append another record's contents (used to merge per-thread data)
+    void append(const PlotData& o);
+
+    void clear();
+
+private:
+    size_t maxLabels_ = 0;
+};
+
+#endif // PLOT_DATA_H
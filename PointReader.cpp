@@ -0,0 +1,486 @@
+//------------------------------------------------------------------------------
+// File: PointReader.cpp
+//
+// In-place parsing of "label,X,Y,Z" records and the memory-mapped input file
+// (see PointReader.h).
+//------------------------------------------------------------------------------
+
+#include "PointReader.h"
+
+#include <iostream>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+//------------------------------------------------------------------------------
+// Exact powers of ten (all representable as doubles)
+//------------------------------------------------------------------------------
+static const double kPow10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static inline bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static inline bool isDigit(char c) {
+    return static_cast<unsigned char>(c - '0') < 10;
+}
+
+//------------------------------------------------------------------------------
+// Decimal number → double
+//   Fast path: up to 19 significant digits with a mantissa below 2^53 and a
+//   decimal exponent within ±22 is converted exactly (one correctly rounded
+//   multiplication or division of two exact doubles). Everything else is
+//   handed to strtod on a NUL-terminated copy of the token.
+//------------------------------------------------------------------------------
+bool parseDouble(const char*& p, const char* end, double& value) {
+
+    const char* s = p;
+    bool negative = false;
+    if (s < end && (*s == '+' || *s == '-')) {
+        negative = (*s == '-');
+        ++s;
+    }
+
+    uint64_t mantissa = 0;
+    int      nDigits  = 0;      // significant digits accumulated
+    int      exp10    = 0;
+    bool     anyDigit = false;
+
+    while (s < end && isDigit(*s)) {
+        anyDigit = true;
+        if (nDigits < 19) {
+            mantissa = mantissa * 10 + (*s - '0');
+            if (mantissa) ++nDigits;
+        } else {
+            ++exp10;
+            ++nDigits;
+        }
+        ++s;
+    }
+    if (s < end && *s == '.') {
+        ++s;
+        while (s < end && isDigit(*s)) {
+            anyDigit = true;
+            if (nDigits < 19) {
+                mantissa = mantissa * 10 + (*s - '0');
+                if (mantissa) ++nDigits;
+                --exp10;
+            } else {
+                ++nDigits;
+            }
+            ++s;
+        }
+    }
+    if (!anyDigit) return false;
+
+    if (s < end && (*s == 'e' || *s == 'E')) {
+        const char* e = s + 1;
+        bool expNegative = false;
+        if (e < end && (*e == '+' || *e == '-')) {
+            expNegative = (*e == '-');
+            ++e;
+        }
+        if (e < end && isDigit(*e)) {
+            int ev = 0;
+            while (e < end && isDigit(*e)) {
+                if (ev < 100000) ev = ev * 10 + (*e - '0');
+                ++e;
+            }
+            exp10 += expNegative ? -ev : ev;
+            s = e;
+        }
+    }
+
+    if (nDigits <= 19 && mantissa < (uint64_t(1) << 53) &&
+        exp10 >= -22 && exp10 <= 22) {
+        double v = static_cast<double>(mantissa);
+        v = (exp10 < 0) ? v / kPow10[-exp10] : v * kPow10[exp10];
+        value = negative ? -v : v;
+        p = s;
+        return true;
+    }
+
+    // Slow path: strtod on a NUL-terminated copy (on the heap for the rare
+    // token that does not fit the stack buffer)
+    char buf[128];
+    std::string heapCopy;
+    size_t len = static_cast<size_t>(s - p);
+    const char* token = buf;
+    if (len < sizeof(buf)) {
+        std::memcpy(buf, p, len);
+        buf[len] = '\0';
+    } else {
+        heapCopy.assign(p, len);
+        token = heapCopy.c_str();
+    }
+    char* stop = nullptr;
+    value = std::strtod(token, &stop);
+    if (stop != token + len) return false;
+    p = s;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+// One record: label , X , Y , Z
+//------------------------------------------------------------------------------
+static ParseStatus malformed(ParseError* error, const char* begin, const char* at,
+                             const char* what) {
+    if (error) {
+        error->column = static_cast<long>(at - begin) + 1;
+        error->what   = what;
+    }
+    return ParseStatus::Malformed;
+}
+
+// Messages for the numeric columns: X, Y, Z, then the orientation
+struct ColumnMessages {
+    const char* number;     // no number where one is expected
+    const char* comma;      // no ',' after it
+    const char* after;      // text after the last column
+    const char* range;      // too large for a double
+};
+
+static const ColumnMessages kCoordMessages[3] = {
+    { "expected a number for X", "expected ',' after X", "unexpected text after X",
+      "X out of range" },
+    { "expected a number for Y", "expected ',' after Y", "unexpected text after Y",
+      "Y out of range" },
+    { "expected a number for Z", "expected ',' after Z", "unexpected text after Z",
+      "Z out of range" }
+};
+static const ColumnMessages kAngleMessages = {
+    "expected a number for the angle", "expected ',' after the angle",
+    "unexpected text after the angle", "angle out of range"
+};
+static const ColumnMessages kQuaternionMessages[4] = {
+    { "expected a number for qw", "expected ',' after qw", "unexpected text after qw",
+      "qw out of range" },
+    { "expected a number for qx", "expected ',' after qx", "unexpected text after qx",
+      "qx out of range" },
+    { "expected a number for qy", "expected ',' after qy", "unexpected text after qy",
+      "qy out of range" },
+    { "expected a number for qz", "expected ',' after qz", "unexpected text after qz",
+      "qz out of range" }
+};
+
+static const ColumnMessages& columnMessages(Orientation orientation, int i) {
+    if (i < 3) return kCoordMessages[i];
+    if (orientation == Orientation::AngleZ) return kAngleMessages;
+    return kQuaternionMessages[i - 3];
+}
+
+// Orientation columns → unit quaternion; false for a zero quaternion
+static bool orientationQuaternion(Orientation orientation, const double* values, double* q) {
+    if (orientation == Orientation::AngleZ) {
+        double half = values[0] * (M_PI / 360.0);
+        q[0] = std::cos(half);
+        q[1] = 0;
+        q[2] = 0;
+        q[3] = std::sin(half);
+        return true;
+    }
+    double norm = std::sqrt(values[0] * values[0] + values[1] * values[1] +
+                            values[2] * values[2] + values[3] * values[3]);
+    if (!(norm > 0) || !std::isfinite(norm)) return false;
+    for (int k = 0; k < 4; ++k) q[k] = values[k] / norm;
+    return true;
+}
+
+ParseStatus parseRecord(const char* begin, const char* end, PointRecord& rec,
+                        ParseError* error, Orientation orientation) {
+
+    const char* p = begin;
+    while (p < end && isBlank(*p)) ++p;
+    if (p == end || *p == '#') return ParseStatus::Skip;
+
+    // Label
+    const char* labelBegin = p;
+    while (p < end && *p != ',') ++p;
+    if (p == end) return malformed(error, begin, p, "expected ',' after the label");
+    const char* labelEnd = p;
+    while (labelEnd > labelBegin && isBlank(labelEnd[-1])) --labelEnd;
+    rec.label = std::string_view(labelBegin, labelEnd - labelBegin);
+
+    // Coordinates, then the orientation columns
+    const int nColumns = 3 + orientationColumns(orientation);
+    double values[7];
+    const char* orientationBegin = end;
+    for (int i = 0; i < nColumns; ++i) {
+        const ColumnMessages& msg = columnMessages(orientation, i);
+        ++p;                                    // skip ','
+        while (p < end && isBlank(*p)) ++p;
+        if (i == 3) orientationBegin = p;
+        const char* number = p;
+        if (!parseDouble(p, end, values[i])) return malformed(error, begin, p, msg.number);
+        if (!std::isfinite(values[i])) return malformed(error, begin, number, msg.range);
+        while (p < end && isBlank(*p)) ++p;
+        if (i < nColumns - 1 && (p == end || *p != ',')) {
+            return malformed(error, begin, p, msg.comma);
+        }
+    }
+    if (p != end) {
+        return malformed(error, begin, p, columnMessages(orientation, nColumns - 1).after);
+    }
+
+    rec.x = values[0];
+    rec.y = values[1];
+    rec.z = values[2];
+    if (orientation != Orientation::None &&
+        !orientationQuaternion(orientation, values + 3, rec.q)) {
+        return malformed(error, begin, orientationBegin, "zero or invalid quaternion");
+    }
+    return ParseStatus::Ok;
+}
+
+void reportMalformed(long line, const ParseError& error) {
+    std::cerr << "Line " << line << ", column " << error.column << ": " << error.what
+              << "; record skipped\n";
+}
+
+//------------------------------------------------------------------------------
+// MappedFile
+//------------------------------------------------------------------------------
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const std::string& fileName) {
+
+    close();
+
+    int fd = ::open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Error opening input file " << fileName << "\n";
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        std::cerr << "Error reading input file " << fileName << "\n";
+        ::close(fd);
+        return false;
+    }
+
+    size_ = static_cast<size_t>(st.st_size);
+    if (size_ == 0) {                           // nothing to map
+        ::close(fd);
+        return true;
+    }
+
+    void* m = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (m == MAP_FAILED) {
+        std::cerr << "Error mapping input file " << fileName << "\n";
+        size_ = 0;
+        return false;
+    }
+    madvise(m, size_, MADV_SEQUENTIAL);
+
+    data_ = static_cast<const char*>(m);
+    return true;
+}
+
+void MappedFile::close() {
+    if (data_) {
+        munmap(const_cast<char*>(data_), size_);
+    }
+    data_ = nullptr;
+    size_ = 0;
+}
+
+//------------------------------------------------------------------------------
+// DelimiterScanner
+//   Bit i of the mask is set if block[i] is ',' or '\n'. Full blocks are
+//   compared 32, 16 or 16 bytes at a time; the last, partial block of the
+//   text byte by byte (nothing beyond end is read).
+//------------------------------------------------------------------------------
+void DelimiterScanner::load(const char* block) {
+
+    block_ = block;
+    uint64_t m = 0;
+
+    if (end_ - block >= 64) {
+#if defined(__AVX2__)
+        const __m256i comma = _mm256_set1_epi8(',');
+        const __m256i nl    = _mm256_set1_epi8('\n');
+        for (int i = 0; i < 64; i += 32) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + i));
+            __m256i d = _mm256_or_si256(_mm256_cmpeq_epi8(v, comma), _mm256_cmpeq_epi8(v, nl));
+            m |= uint64_t(uint32_t(_mm256_movemask_epi8(d))) << i;
+        }
+#elif defined(__SSE2__)
+        const __m128i comma = _mm_set1_epi8(',');
+        const __m128i nl    = _mm_set1_epi8('\n');
+        for (int i = 0; i < 64; i += 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i));
+            __m128i d = _mm_or_si128(_mm_cmpeq_epi8(v, comma), _mm_cmpeq_epi8(v, nl));
+            m |= uint64_t(uint32_t(_mm_movemask_epi8(d))) << i;
+        }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+        // No movemask on NEON: weight the lanes by bit, then add pairwise
+        static const uint8_t kBits[16] = { 1, 2, 4, 8, 16, 32, 64, 128,
+                                           1, 2, 4, 8, 16, 32, 64, 128 };
+        const uint8x16_t bits  = vld1q_u8(kBits);
+        const uint8x16_t comma = vdupq_n_u8(',');
+        const uint8x16_t nl    = vdupq_n_u8('\n');
+        uint8x16_t d[4];
+        for (int i = 0; i < 4; ++i) {
+            uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t*>(block) + 16 * i);
+            d[i] = vandq_u8(vorrq_u8(vceqq_u8(v, comma), vceqq_u8(v, nl)), bits);
+        }
+        uint8x16_t sum = vpaddq_u8(vpaddq_u8(d[0], d[1]), vpaddq_u8(d[2], d[3]));
+        sum = vpaddq_u8(sum, sum);
+        m = vgetq_lane_u64(vreinterpretq_u64_u8(sum), 0);
+#else
+        for (int i = 0; i < 64; ++i) {
+            if (block[i] == ',' || block[i] == '\n') m |= uint64_t(1) << i;
+        }
+#endif
+    } else {
+        for (int i = 0; block + i < end_; ++i) {
+            if (block[i] == ',' || block[i] == '\n') m |= uint64_t(1) << i;
+        }
+    }
+    mask_ = m;
+}
+
+//------------------------------------------------------------------------------
+// CsvPointReader
+//------------------------------------------------------------------------------
+
+// A number that fills [begin, end) exactly. Plain decimals of up to 15
+// digits ("-1234.567"), by far the most common field, are converted here
+// without parseDouble()'s bookkeeping; the value is the same, as the
+// mantissa is exact and one division by an exact power of ten rounds once.
+static inline bool parseField(const char* begin, const char* end, double& value) {
+    const char* p = begin;
+    bool negative = (p < end && *p == '-');
+    if (negative) ++p;
+
+    if (end - p <= 16) {
+        uint64_t    mantissa = 0;
+        int         nDigits  = 0;
+        const char* dot      = nullptr;
+        for (const char* q = p; q < end; ++q) {
+            unsigned d = static_cast<unsigned char>(*q - '0');
+            if (d < 10) {
+                mantissa = mantissa * 10 + d;
+                ++nDigits;
+            } else if (*q == '.' && !dot) {
+                dot = q;
+            } else {
+                nDigits = 0;
+                break;
+            }
+        }
+        if (nDigits > 0 && nDigits <= 15) {
+            double v = static_cast<double>(mantissa);
+            if (dot) v /= kPow10[end - dot - 1];
+            value = negative ? -v : v;
+            return true;
+        }
+    }
+
+    // Overflow (±inf) is left to parseRecord() to report
+    p = begin;
+    return parseDouble(p, end, value) && p == end && std::isfinite(value);
+}
+
+// Plain "label,X,Y,Z" between the delimiters found by the scanner. On
+// false, stop is the last delimiter looked at (or lineBegin), from where
+// the caller looks for the end of the line.
+bool CsvPointReader::parseFields(const char* lineBegin, PointRecord& rec, const char*& stop) {
+    const char* comma[7];
+    const char* p = lineBegin;
+    for (int i = 0; i < columns_; ++i) {
+        stop = scanner_.next(p);
+        if (stop == end_ || *stop == '\n') return false;
+        comma[i] = stop;
+        p = stop + 1;
+    }
+    const char* lineEnd = stop = scanner_.next(p);
+    if (lineEnd < end_ && *lineEnd == ',') return false;     // too many fields
+
+    const char* lastEnd = lineEnd;
+    if (lastEnd > comma[columns_ - 1] + 1 && lastEnd[-1] == '\r') --lastEnd;
+    if (comma[0] > lineBegin && isBlank(comma[0][-1])) return false;
+
+    double values[7];
+    for (int i = 0; i < columns_; ++i) {
+        const char* fieldEnd = (i + 1 < columns_) ? comma[i + 1] : lastEnd;
+        if (!parseField(comma[i] + 1, fieldEnd, values[i])) return false;
+    }
+    if (orientation_ != Orientation::None &&
+        !orientationQuaternion(orientation_, values + 3, rec.q)) {
+        return false;
+    }
+    rec.label = std::string_view(lineBegin, static_cast<size_t>(comma[0] - lineBegin));
+    rec.x = values[0];
+    rec.y = values[1];
+    rec.z = values[2];
+    return true;
+}
+
+bool CsvPointReader::next(PointRecord& rec) {
+
+    while (cur_ < end_) {
+
+        const char* lineBegin = cur_;
+        const char* lineEnd   = cur_;
+        ++lineNo_;
+
+        // Fast path; blank, comment and irregular lines go to parseRecord()
+        if (!isBlank(*lineBegin) && *lineBegin != '#' &&
+            parseFields(lineBegin, rec, lineEnd)) {
+            cur_ = (lineEnd < end_) ? lineEnd + 1 : end_;
+            return true;
+        }
+
+        while (lineEnd < end_ && *lineEnd != '\n') lineEnd = scanner_.next(lineEnd + 1);
+        cur_ = (lineEnd < end_) ? lineEnd + 1 : end_;
+
+        ParseError error;
+        switch (parseRecord(lineBegin, lineEnd, rec, &error, orientation_)) {
+        case ParseStatus::Ok:
+            return true;
+        case ParseStatus::Skip:
+            break;
+        case ParseStatus::Malformed:
+            ++malformed_;
+            if (malformedRecords_) {
+                malformedRecords_->push_back({ lineNo_, error });
+            } else {
+                reportMalformed(lineNo_, error);
+            }
+            break;
+        }
+    }
+    return false;
+}
+
+//------------------------------------------------------------------------------
+// Newline-aligned ranges
+//------------------------------------------------------------------------------
+const char* lineBoundary(const char* begin, const char* end, size_t bytes) {
+    if (static_cast<size_t>(end - begin) <= bytes) return end;
+    const char* nl = static_cast<const char*>(
+        std::memchr(begin + bytes, '\n', static_cast<size_t>(end - begin) - bytes));
+    return nl ? nl + 1 : end;
+}
@@ -0,0 +1,270 @@
+/*------------------------------------------------------------------------------
+ * File: PointReader.h
+ *
+ * Fast readers for "label,X,Y,Z" input that never build a std::vector<Point>.
+ *
+ * Contents:
+ *   • PointRecord    — one parsed record; the label is a view into the input
+ *   • Orientation    — optional orientation columns after X,Y,Z
+ *   • parseRecord()  — parse a single record from a character range
+ *   • ParseError     — where and why a record is malformed
+ *   • MappedFile     — read-only memory mapping of an input file
+ *   • DelimiterScanner — finds ',' and '\n' 64 bytes at a time (SIMD)
+ *   • CsvPointReader — iterates the records of a character range in order
+ *   • lineBoundary() — cut a text into newline-aligned ranges for parallel
+ *                      parsing
+ *   • PointBatch     — a block of records stored column-wise, owning its labels
+ *
+ * Numbers are parsed in place: the common "few decimals" case is converted
+ * exactly with integer arithmetic, anything else falls back to strtod, so
+ * the values are identical to those produced by readPoints().
+ *
+ * CsvPointReader locates the delimiters of a whole block with SIMD compares
+ * and parses the fields between them directly; only lines that are not a
+ * plain "label,X,Y,Z" (blanks, comments, errors) go through parseRecord().
+ *
+ *------------------------------------------------------------------------------*/
+
+#ifndef POINT_READER_H
+#define POINT_READER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*------------------------------------------------------------------------------
+ * Optional orientation columns after X,Y,Z (AddDisplacedPoints --orientation)
+ *   AngleZ     — one column: rotation about Z in degrees
+ *   Quaternion — four columns w,x,y,z (normalized when read)
+ * Either way the record carries the orientation as a unit quaternion.
+ *------------------------------------------------------------------------------*/
+enum class Orientation { None, AngleZ, Quaternion };
+
+inline int orientationColumns(Orientation o) {
+    return o == Orientation::AngleZ ? 1 : o == Orientation::Quaternion ? 4 : 0;
+}
+
+/*------------------------------------------------------------------------------
+ * One input record. label points into the caller's buffer (or mapping)
+ * and stays valid only as long as that buffer does.
+ *------------------------------------------------------------------------------*/
+struct PointRecord {
+    std::string_view label;
+    double x;
+    double y;
+    double z;
+    double q[4];        // orientation w,x,y,z; set only with an Orientation
+};
+
+/*------------------------------------------------------------------------------
+ * Result of parseRecord()
+ *------------------------------------------------------------------------------*/
+enum class ParseStatus {
+    Ok,         // rec filled
+    Skip,       // blank line or '#' comment
+    Malformed   // not a label,X,Y,Z record
+};
+
+/*------------------------------------------------------------------------------
+ * Where a malformed record goes wrong: column (1-based, in bytes) of the
+ * offending character, or one past the end of the line if something is
+ * missing, and what was expected there
+ *------------------------------------------------------------------------------*/
+struct ParseError {
+    long        column = 0;
+    const char* what   = "";
+};
+
+struct MalformedRecord {
+    long       line;
+    ParseError error;
+};
+
+// "Line 12, column 7: expected a number for Y; record skipped" on stderr
+void reportMalformed(long line, const ParseError& error);
+
+/*------------------------------------------------------------------------------
+ * Parse one record from [begin, end) (no line terminator; a trailing '\r'
+ * is ignored). Leading/trailing blanks around fields are ignored. For a
+ * malformed record, error (if given) tells where and why. With an
+ * orientation the record has its columns after Z.
+ *------------------------------------------------------------------------------*/
+ParseStatus parseRecord(const char* begin, const char* end, PointRecord& rec,
+                        ParseError* error = nullptr,
+                        Orientation orientation = Orientation::None);
+
+/*------------------------------------------------------------------------------
+ * Parse a decimal floating point number starting at p (no leading blanks).
+ * On success stores the value, advances p past the number and returns true.
+ * A number too large for a double gives ±inf, as with strtod; parseRecord()
+ * reports it as out of range.
+ *------------------------------------------------------------------------------*/
+bool parseDouble(const char*& p, const char* end, double& value);
+
+/*------------------------------------------------------------------------------
+ * Read-only memory mapping of a whole file
+ *------------------------------------------------------------------------------*/
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Map the file; returns false (with a message on stderr) on failure
+    bool open(const std::string& fileName);
+    void close();
+
+    const char* data() const { return data_; }
+    size_t      size() const { return size_; }
+    const char* begin() const { return data_; }
+    const char* end()   const { return data_ + size_; }
+
+private:
+    const char* data_ = nullptr;
+    size_t      size_ = 0;
+};
+
+/*------------------------------------------------------------------------------
+ * Positions of ',' and '\n' in [begin, end). The text is classified in
+ * blocks of 64 bytes into a bit mask, with AVX2 or SSE2 compares on x86-64
+ * and NEON on ARM when the compiler targets them, a plain loop otherwise;
+ * next() then costs a bit scan.
+ *------------------------------------------------------------------------------*/
+class DelimiterScanner {
+public:
+    DelimiterScanner(const char* begin, const char* end) : begin_(begin), end_(end) {}
+
+    // First ',' or '\n' at or after p, or end. Cheapest when called with
+    // increasing p (a block is classified once).
+    const char* next(const char* p) {
+        for (;;) {
+            if (p >= end_) return end_;
+            // p - block_ is only defined once p is known to be in or after
+            // the block (block_ is null before the first load)
+            if (!block_ || p < block_ || static_cast<size_t>(p - block_) >= 64) {
+                load(begin_ + (static_cast<size_t>(p - begin_) & ~size_t(63)));
+            }
+            size_t offset = static_cast<size_t>(p - block_);
+            uint64_t m = mask_ & (~uint64_t(0) << offset);
+            if (m) return block_ + __builtin_ctzll(m);
+            p = block_ + 64;
+        }
+    }
+
+private:
+    void load(const char* block);
+
+    const char* begin_;
+    const char* end_;
+    const char* block_ = nullptr;   // block described by mask_
+    uint64_t    mask_  = 0;         // bit i: block_[i] is ',' or '\n'
+};
+
+/*------------------------------------------------------------------------------
+ * Iterates the records in [begin, end). Malformed records are skipped and
+ * reported on stderr with their line and column, or, with malformed, only
+ * collected there (for readers running on several threads, whose messages
+ * must come out in input order).
+ *------------------------------------------------------------------------------*/
+class CsvPointReader {
+public:
+    CsvPointReader(const char* begin, const char* end, long firstLine = 1,
+                   std::vector<MalformedRecord>* malformed = nullptr,
+                   Orientation orientation = Orientation::None)
+        : cur_(begin), end_(end), lineNo_(firstLine - 1), scanner_(begin, end),
+          malformedRecords_(malformed), orientation_(orientation),
+          columns_(3 + orientationColumns(orientation)) {}
+
+    // Fill rec with the next record; false at end of input
+    bool next(PointRecord& rec);
+
+    long lineNumber() const { return lineNo_; }   // line of the last record
+    long malformed()  const { return malformed_; }
+
+private:
+    bool parseFields(const char* lineBegin, PointRecord& rec, const char*& stop);
+
+    const char*      cur_;
+    const char*      end_;
+    long             lineNo_;
+    long             malformed_ = 0;
+    DelimiterScanner scanner_;
+    std::vector<MalformedRecord>* malformedRecords_;
+    Orientation      orientation_;
+    int              columns_;          // numbers after the label
+};
+
+/*------------------------------------------------------------------------------
+ * End of a range of about `bytes` bytes starting at begin: just past the
+ * first '\n' at or after begin + bytes, or end. Ranges cut this way hold
+ * whole records and can be parsed independently; their records in range
+ * order are those of the whole text.
+ *------------------------------------------------------------------------------*/
+const char* lineBoundary(const char* begin, const char* end, size_t bytes);
+
+/*------------------------------------------------------------------------------
+ * A block of points stored column-wise. Labels are copied into one shared
+ * character array, so a batch stays valid after its source is gone and
+ * can be handed to another thread. Capacity is kept across clear().
+ * Orientations (unit quaternions) are kept only if appended for every point.
+ *------------------------------------------------------------------------------*/
+class PointBatch {
+public:
+    void append(std::string_view label, double x, double y, double z) {
+        labels_.append(label.data(), label.size());
+        labelEnd_.push_back(labels_.size());
+        x_.push_back(x);
+        y_.push_back(y);
+        z_.push_back(z);
+    }
+
+    // Orientation w,x,y,z of the point appended last
+    void appendOrientation(const double* q) {
+        qw_.push_back(q[0]);
+        qx_.push_back(q[1]);
+        qy_.push_back(q[2]);
+        qz_.push_back(q[3]);
+    }
+
+    void clear() {
+        labels_.clear();
+        labelEnd_.clear();
+        x_.clear();
+        y_.clear();
+        z_.clear();
+        qw_.clear();
+        qx_.clear();
+        qy_.clear();
+        qz_.clear();
+    }
+
+    size_t size()  const { return x_.size(); }
+    bool   empty() const { return x_.empty(); }
+
+    std::string_view label(size_t i) const {
+        size_t b = i ? labelEnd_[i - 1] : 0;
+        return std::string_view(labels_.data() + b, labelEnd_[i] - b);
+    }
+
+    const double* x() const { return x_.data(); }
+    const double* y() const { return y_.data(); }
+    const double* z() const { return z_.data(); }
+
+    bool          oriented() const { return !qw_.empty(); }
+    const double* qw() const { return qw_.data(); }
+    const double* qx() const { return qx_.data(); }
+    const double* qy() const { return qy_.data(); }
+    const double* qz() const { return qz_.data(); }
+
+private:
+    std::string         labels_;
+    std::vector<size_t> labelEnd_;
+    std::vector<double> x_, y_, z_;
+    std::vector<double> qw_, qx_, qy_, qz_;
+};
+
+#endif // POINT_READER_H
@@ -0,0 +1,177 @@
+//------------------------------------------------------------------------------
+// File: PointWriter.cpp
+//
+// Buffered CSV formatting and output (see PointWriter.h).
+//------------------------------------------------------------------------------
+
+#include "PointWriter.h"
+
+#include <iostream>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//------------------------------------------------------------------------------
+// TextBuffer
+//------------------------------------------------------------------------------
+char* TextBuffer::reserve(size_t n) {
+    if (size_ + n > data_.size()) {
+        size_t cap = data_.size() * 2;
+        if (cap < size_ + n) cap = size_ + n;
+        data_.resize(cap);
+    }
+    return data_.data() + size_;
+}
+
+void TextBuffer::append(std::string_view s) {
+    char* p = reserve(s.size());
+    std::memcpy(p, s.data(), s.size());
+    size_ += s.size();
+}
+
+void TextBuffer::append(char c) {
+    *reserve(1) = c;
+    ++size_;
+}
+
+//------------------------------------------------------------------------------
+// Fixed-point formatting with 3 decimals
+//   printf rounds the exact binary value to nearest. For |v| < 1e9 the
+//   product v*1000 is within 1e-4 of the exact value, so rounding it agrees
+//   with printf unless it lies close to a .5 boundary; those values, huge
+//   values and NaN/Inf go through snprintf.
+//------------------------------------------------------------------------------
+static inline bool roundFixed3(double a, uint64_t& n) {
+    double scaled = a * 1000.0;
+    double whole  = std::floor(scaled);
+    double frac   = scaled - whole;
+    if (!(a < 1e9) || std::fabs(frac - 0.5) < 1e-3) return false;
+    n = static_cast<uint64_t>(whole) + (frac > 0.5 ? 1 : 0);
+    return true;
+}
+
+void TextBuffer::appendFixed3(double v) {
+
+    uint64_t n;
+    if (!roundFixed3(std::fabs(v), n)) {
+        char* p = reserve(512);                 // DBL_MAX needs ~314 chars
+        int len = std::snprintf(p, 512, "%.3f", v);
+        size_ += static_cast<size_t>(len);
+        return;
+    }
+    uint64_t intPart  = n / 1000;
+    unsigned fracPart = static_cast<unsigned>(n % 1000);
+
+    char digits[24];
+    int nd = 0;
+    do {
+        digits[nd++] = static_cast<char>('0' + intPart % 10);
+        intPart /= 10;
+    } while (intPart);
+
+    char* p = reserve(static_cast<size_t>(nd) + 6);
+    char* q = p;
+    if (std::signbit(v)) *q++ = '-';
+    while (nd) *q++ = digits[--nd];
+    *q++ = '.';
+    q[0] = static_cast<char>('0' + fracPart / 100);
+    q[1] = static_cast<char>('0' + fracPart / 10 % 10);
+    q[2] = static_cast<char>('0' + fracPart % 10);
+    q += 3;
+    size_ += static_cast<size_t>(q - p);
+}
+
+bool fixed3Units(double v, int64_t& units) {
+
+    uint64_t n;
+    if (roundFixed3(std::fabs(v), n)) {
+        units = std::signbit(v) ? -static_cast<int64_t>(n) : static_cast<int64_t>(n);
+        return true;
+    }
+    if (!(std::fabs(v) < 9e15)) return false;
+
+    // Near a rounding boundary: take the digits printf produces
+    char buf[64];
+    std::snprintf(buf, sizeof(buf), "%.3f", v);
+    int64_t u = 0;
+    for (const char* p = buf; *p; ++p) {
+        if (*p >= '0' && *p <= '9') u = u * 10 + (*p - '0');
+    }
+    units = (buf[0] == '-') ? -u : u;
+    return true;
+}
+
+void TextBuffer::appendPoint(std::string_view label, std::string_view ext,
+                             double x, double y, double z) {
+    append(label);
+    append(ext);
+    append(',');
+    appendFixed3(x);
+    append(',');
+    appendFixed3(y);
+    append(',');
+    appendFixed3(z);
+    append('\n');
+}
+
+//------------------------------------------------------------------------------
+// OutputFile
+//------------------------------------------------------------------------------
+OutputFile::~OutputFile() {
+    close();
+}
+
+bool OutputFile::open(const std::string& fileName) {
+    close();
+    name_ = fileName;
+    bytes_ = 0;
+    fd_ = ::open(fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd_ < 0) {
+        std::cerr << "Error opening output file " << fileName << "\n";
+        return false;
+    }
+    // Only a regular file may be deleted by discard() (not /dev/null etc.)
+    struct stat st;
+    created_ = fstat(fd_, &st) == 0 && S_ISREG(st.st_mode);
+    return true;
+}
+
+bool OutputFile::write(const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = ::write(fd_, data, size);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "Error writing output file " << name_ << ": "
+                      << std::strerror(errno) << "\n";
+            return false;
+        }
+        data   += n;
+        size   -= static_cast<size_t>(n);
+        bytes_ += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool OutputFile::close() {
+    if (fd_ < 0) return true;
+    int rc = ::close(fd_);
+    fd_ = -1;
+    if (rc != 0) {
+        std::cerr << "Error closing output file " << name_ << "\n";
+        return false;
+    }
+    return true;
+}
+
+void OutputFile::discard() {
+    if (fd_ >= 0) ::close(fd_);
+    fd_ = -1;
+    if (created_) ::unlink(name_.c_str());
+    created_ = false;
+}
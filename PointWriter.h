@@ -0,0 +1,99 @@
+/*------------------------------------------------------------------------------
+ * File: PointWriter.h
+ *
+ * Buffered CSV output for AddDisplacedPoints.
+ *
+ * Contents:
+ *   • TextBuffer — growable byte buffer with a dedicated "%.3f" formatter
+ *   • OutputFile — plain POSIX file written with large write() calls
+ *   • fixed3Units() — a value in units of 0.001, rounded as "%.3f" rounds
+ *
+ * TextBuffer::appendFixed3() produces exactly the bytes that
+ *     out << std::fixed << std::setprecision(3) << v
+ * produces, without locale handling or per-value stream overhead.
+ *
+ *------------------------------------------------------------------------------*/
+
+#ifndef POINT_WRITER_H
+#define POINT_WRITER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*------------------------------------------------------------------------------
+ * Growable output buffer
+ *------------------------------------------------------------------------------*/
+class TextBuffer {
+public:
+    explicit TextBuffer(size_t reserveBytes = 1 << 20) { data_.resize(reserveBytes); }
+
+    void append(std::string_view s);
+    void append(char c);
+    void appendBytes(const void* p, size_t n) {
+        append(std::string_view(static_cast<const char*>(p), n));
+    }
+
+    // v with exactly 3 decimals, as printf("%.3f")
+    void appendFixed3(double v);
+
+    // "label<ext>,x,y,z\n"
+    void appendPoint(std::string_view label, std::string_view ext,
+                     double x, double y, double z);
+
+    const char* data() const { return data_.data(); }
+    size_t      size() const { return size_; }
+    bool        empty() const { return size_ == 0; }
+    void        clear() { size_ = 0; }
+
+private:
+    char* reserve(size_t n);    // room for n more bytes
+
+    std::vector<char> data_;
+    size_t            size_ = 0;
+};
+
+/*------------------------------------------------------------------------------
+ * v * 1000 rounded to an integer exactly as printf("%.3f", v) rounds v
+ * (the digits of that output without the point). False for NaN, Inf or
+ * |v| >= 9e15.
+ *------------------------------------------------------------------------------*/
+bool fixed3Units(double v, int64_t& units);
+
+/*------------------------------------------------------------------------------
+ * Output file written with write(2)
+ *------------------------------------------------------------------------------*/
+class OutputFile {
+public:
+    OutputFile() = default;
+    ~OutputFile();
+
+    OutputFile(const OutputFile&) = delete;
+    OutputFile& operator=(const OutputFile&) = delete;
+
+    // Create/truncate the file; false (with a message on stderr) on failure
+    bool open(const std::string& fileName);
+
+    // Write the whole buffer; false on I/O error
+    bool write(const char* data, size_t size);
+    bool write(const TextBuffer& buf) { return write(buf.data(), buf.size()); }
+
+    // Close the file; false if closing reported an error
+    bool close();
+
+    // Close and delete the file opened by open() (after a failed run), so
+    // no truncated output is left behind; devices and pipes are only closed
+    void discard();
+
+    size_t bytesWritten() const { return bytes_; }
+
+private:
+    int         fd_ = -1;
+    std::string name_;
+    size_t      bytes_ = 0;
+    bool        created_ = false;
+};
+
+#endif // POINT_WRITER_H
@@ -0,0 +1,189 @@
+//------------------------------------------------------------------------------
+// File: Stats.cpp
+//
+// Run statistics for --stats (see Stats.h).
+//------------------------------------------------------------------------------
+
+#include "Stats.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+#include <sys/resource.h>
+#include <time.h>
+
+//------------------------------------------------------------------------------
+// Stages
+//------------------------------------------------------------------------------
+const char* stageName(Stage s) {
+    switch (s) {
+        case Stage::Read:     return "read";
+        case Stage::Classify: return "classify";
+        case Stage::Expand:   return "expand";
+        case Stage::Format:   return "format";
+        case Stage::Write:    return "write";
+        case Stage::Plot:     return "plot";
+        case Stage::PlotPng:  return "png";
+        case Stage::PlotRoot: return "root-file";
+        case Stage::Count:    break;
+    }
+    return "?";
+}
+
+//------------------------------------------------------------------------------
+// StageTimer
+//------------------------------------------------------------------------------
+static double seconds(const timespec& ts) {
+    return static_cast<double>(ts.tv_sec) + ts.tv_nsec * 1e-9;
+}
+
+double StageTimer::wallNow() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return seconds(ts);
+}
+
+double StageTimer::threadCpuNow() {
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return seconds(ts);
+}
+
+void StageTimer::restart() {
+    if (!times_) return;
+    wall0_ = wallNow();
+    cpu0_  = threadCpuNow();
+}
+
+void StageTimer::lap(Stage s) {
+    if (!times_) return;
+    double wall = wallNow();
+    double cpu  = threadCpuNow();
+    times_->wall[static_cast<size_t>(s)] += wall - wall0_;
+    times_->cpu[static_cast<size_t>(s)]  += cpu - cpu0_;
+    wall0_ = wall;
+    cpu0_  = cpu;
+}
+
+//------------------------------------------------------------------------------
+// RunStats
+//------------------------------------------------------------------------------
+RunStats::RunStats(const Geometry& geometry, const std::string& jsonFile)
+    : geometry_(geometry), jsonFile_(jsonFile), wallStart_(StageTimer::wallNow()) {
+    counts.perSet.resize(geometry.sets.size());
+}
+
+// Process CPU time (user + system) and peak resident set size in bytes
+static void processUsage(double& cpu, uint64_t& peakRss) {
+    rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    cpu = ru.ru_utime.tv_sec + ru.ru_utime.tv_usec * 1e-6 +
+          ru.ru_stime.tv_sec + ru.ru_stime.tv_usec * 1e-6;
+#if defined(__APPLE__)
+    peakRss = static_cast<uint64_t>(ru.ru_maxrss);           // bytes
+#else
+    peakRss = static_cast<uint64_t>(ru.ru_maxrss) * 1024;    // kilobytes
+#endif
+}
+
+// Set names come from geometry files: escape them for JSON
+static std::string jsonString(const std::string& s) {
+    std::string out = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char buf[8];
+            std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+            out += buf;
+        } else {
+            out += c;
+        }
+    }
+    return out + "\"";
+}
+
+bool RunStats::report() const {
+
+    double   wall = StageTimer::wallNow() - wallStart_;
+    double   cpu  = 0;
+    uint64_t peakRss = 0;
+    processUsage(cpu, peakRss);
+
+    uint64_t points = counts.fallback + counts.noDigits;
+    for (uint64_t n : counts.perSet) points += n;
+
+    //--------------------------------------------------------------------------
+    // Text summary
+    //--------------------------------------------------------------------------
+    char line[160];
+    std::cerr << "Statistics\n";
+    std::snprintf(line, sizeof(line), "  %-10s %10s %10s\n", "stage", "wall [s]", "cpu [s]");
+    std::cerr << line;
+    for (size_t i = 0; i < kStageCount; ++i) {
+        if (times.wall[i] == 0 && times.cpu[i] == 0) continue;
+        std::snprintf(line, sizeof(line), "  %-10s %10.3f %10.3f\n",
+                      stageName(static_cast<Stage>(i)), times.wall[i], times.cpu[i]);
+        std::cerr << line;
+    }
+    std::snprintf(line, sizeof(line), "  %-10s %10.3f %10.3f\n", "total", wall, cpu);
+    std::cerr << line;
+
+    std::cerr << "  points     " << points << "\n";
+    for (size_t s = 0; s < geometry_.sets.size(); ++s) {
+        std::snprintf(line, sizeof(line), "    %-16s %llu\n", geometry_.sets[s].name.c_str(),
+                      static_cast<unsigned long long>(counts.perSet[s]));
+        std::cerr << line;
+    }
+    std::snprintf(line, sizeof(line), "    %-16s %llu\n    %-16s %llu\n",
+                  "fallback", static_cast<unsigned long long>(counts.fallback),
+                  "no digits", static_cast<unsigned long long>(counts.noDigits));
+    std::cerr << line;
+    std::cerr << "  records    " << counts.records << "\n";
+    std::cerr << "  bytes      " << bytesWritten << "\n";
+    std::snprintf(line, sizeof(line), "  peak RSS   %.1f MB\n", peakRss / 1048576.0);
+    std::cerr << line;
+
+    if (jsonFile_.empty()) return true;
+
+    //--------------------------------------------------------------------------
+    // JSON
+    //--------------------------------------------------------------------------
+    std::ofstream out(jsonFile_);
+    if (!out) {
+        std::cerr << "Error opening stats file " << jsonFile_ << "\n";
+        return false;
+    }
+
+    out << "{\n  \"stages\": {";
+    for (size_t i = 0; i < kStageCount; ++i) {
+        std::snprintf(line, sizeof(line), "%s\n    \"%s\": { \"wall\": %.6f, \"cpu\": %.6f }",
+                      i ? "," : "", stageName(static_cast<Stage>(i)),
+                      times.wall[i], times.cpu[i]);
+        out << line;
+    }
+    std::snprintf(line, sizeof(line),
+                  "\n  },\n  \"total\": { \"wall\": %.6f, \"cpu\": %.6f },\n", wall, cpu);
+    out << line;
+
+    out << "  \"points\": " << points << ",\n  \"sets\": {";
+    for (size_t s = 0; s < geometry_.sets.size(); ++s) {
+        out << (s ? ", " : " ") << jsonString(geometry_.sets[s].name) << ": "
+            << counts.perSet[s];
+    }
+    out << " },\n"
+        << "  \"fallback\": " << counts.fallback << ",\n"
+        << "  \"noDigits\": " << counts.noDigits << ",\n"
+        << "  \"recordsWritten\": " << counts.records << ",\n"
+        << "  \"bytesWritten\": " << bytesWritten << ",\n"
+        << "  \"peakRssBytes\": " << peakRss << "\n}\n";
+
+    out.close();
+    if (!out) {
+        std::cerr << "Error writing stats file " << jsonFile_ << "\n";
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,130 @@
+/*------------------------------------------------------------------------------
+ * File: Stats.h
+ *
+ * Run statistics for AddDisplacedPoints --stats.
+ *
+ * Contents:
+ *   • Stage        — the stages whose time is measured
+ *   • StageTimes   — wall and CPU seconds per stage
+ *   • StageTimer   — adds the time since its last lap to a stage
+ *   • PointCounts  — points per displacement set, fallback, no digits
+ *   • RunStats     — everything above for a whole run, plus bytes written and
+ *                    peak RSS; prints a text summary or writes JSON
+ *
+ * Cost: two clock reads per stage per batch of 8192 points, and a pass over
+ * the classification of each batch for the counts, so it can be left on.
+ * Threads record into their own StageTimes/PointCounts, which are merged
+ * on the main thread; for stages run on several threads (classify, expand,
+ * format) wall and CPU time are summed over the threads.
+ *
+ *------------------------------------------------------------------------------*/
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Geometry.h"
+
+/*------------------------------------------------------------------------------
+ * Measured stages
+ *   Read     — reading and parsing the input into batches
+ *   Classify — label number and displacement set of each point
+ *   Expand   — displaced coordinates (expansion kernel)
+ *   Format   — CSV text or binary blocks
+ *   Write    — output file writes and close
+ *   Plot     — collecting plot data and drawing the canvas
+ *   PlotPng  — c->Print() of the PNG
+ *   PlotRoot — writing the ROOT file
+ *------------------------------------------------------------------------------*/
+enum class Stage { Read, Classify, Expand, Format, Write, Plot, PlotPng, PlotRoot, Count };
+
+constexpr size_t kStageCount = static_cast<size_t>(Stage::Count);
+
+const char* stageName(Stage s);
+
+struct StageTimes {
+    double wall[kStageCount] = {};
+    double cpu[kStageCount]  = {};
+
+    void add(const StageTimes& o) {
+        for (size_t i = 0; i < kStageCount; ++i) {
+            wall[i] += o.wall[i];
+            cpu[i]  += o.cpu[i];
+        }
+    }
+};
+
+/*------------------------------------------------------------------------------
+ * Measures consecutive sections of one thread: lap(stage) charges the wall
+ * and thread CPU time since the previous lap (or construction/restart) to
+ * stage. With times == nullptr it does nothing and reads no clocks.
+ *------------------------------------------------------------------------------*/
+class StageTimer {
+public:
+    explicit StageTimer(StageTimes* times) : times_(times) { restart(); }
+
+    void restart();
+    void lap(Stage s);
+
+    static double wallNow();        // monotonic clock, seconds
+    static double threadCpuNow();   // CPU time of the calling thread, seconds
+
+private:
+    StageTimes* times_;
+    double      wall0_ = 0;
+    double      cpu0_  = 0;
+};
+
+/*------------------------------------------------------------------------------
+ * Points per displacement set. A point counts for the set whose ranges
+ * contain its number; points outside all ranges are "fallback" (they use
+ * Geometry::fallback) and points whose label has no number "no digits"
+ * (also drawn from the fallback set).
+ *------------------------------------------------------------------------------*/
+struct PointCounts {
+    std::vector<uint64_t> perSet;
+    uint64_t              fallback = 0;
+    uint64_t              noDigits = 0;
+    uint64_t              records  = 0;   // originals + displaced copies written
+
+    void add(const PointCounts& o) {
+        if (perSet.size() < o.perSet.size()) perSet.resize(o.perSet.size());
+        for (size_t s = 0; s < o.perSet.size(); ++s) perSet[s] += o.perSet[s];
+        fallback += o.fallback;
+        noDigits += o.noDigits;
+        records  += o.records;
+    }
+
+    void clear() {
+        perSet.assign(perSet.size(), 0);
+        fallback = noDigits = records = 0;
+    }
+};
+
+/*------------------------------------------------------------------------------
+ * Statistics of a whole run
+ *------------------------------------------------------------------------------*/
+class RunStats {
+public:
+    // jsonFile: also write the statistics as JSON there ("" = text only)
+    RunStats(const Geometry& geometry, const std::string& jsonFile);
+
+    StageTimes  times;
+    PointCounts counts;
+    uint64_t    bytesWritten = 0;
+
+    // Print the summary on stderr and write the JSON file, if any; false if
+    // the JSON file cannot be written
+    bool report() const;
+
+private:
+    const Geometry& geometry_;
+    std::string     jsonFile_;
+    double          wallStart_;
+};
+
+#endif // STATS_H
@@ -0,0 +1,65 @@
+//------------------------------------------------------------------------------
+// File: ThreadPool.cpp
+//
+// Fork/join thread pool (see ThreadPool.h).
+//------------------------------------------------------------------------------
+
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(unsigned nThreads) {
+    if (nThreads == 0) nThreads = std::thread::hardware_concurrency();
+    if (nThreads == 0) nThreads = 1;
+    for (unsigned i = 1; i < nThreads; ++i) {
+        workers_.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto& t : workers_) t.join();
+}
+
+//------------------------------------------------------------------------------
+// Execute queued indices until none are left (called with the lock held)
+//------------------------------------------------------------------------------
+void ThreadPool::drain(std::unique_lock<std::mutex>& lock) {
+    while (next_ < count_) {
+        size_t i = next_++;
+        const auto* task = task_;
+        lock.unlock();
+        (*task)(i);
+        lock.lock();
+        if (--pending_ == 0) done_.notify_all();
+    }
+}
+
+void ThreadPool::run(size_t n, const std::function<void(size_t)>& task) {
+    if (n == 0) return;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    task_    = &task;
+    next_    = 0;
+    count_   = n;
+    pending_ = n;
+    ++generation_;
+    wake_.notify_all();
+
+    drain(lock);
+    done_.wait(lock, [this] { return pending_ == 0; });
+    task_ = nullptr;
+}
+
+void ThreadPool::workerLoop() {
+    uint64_t seen = 0;
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+        if (stop_) return;
+        seen = generation_;
+        drain(lock);
+    }
+}
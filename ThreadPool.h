@@ -0,0 +1,55 @@
+/*------------------------------------------------------------------------------
+ * File: ThreadPool.h
+ *
+ * Minimal fork/join thread pool used by the parallel modes of
+ * AddDisplacedPoints.
+ *
+ * run(n, task) calls task(i) for every i in [0, n) on the pool threads
+ * (the calling thread helps) and returns when all calls are done. Tasks are
+ * handed out one index at a time, so uneven tasks balance themselves.
+ *
+ *------------------------------------------------------------------------------*/
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+public:
+    // nThreads = total parallelism including the caller (0 → all cores)
+    explicit ThreadPool(unsigned nThreads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void run(size_t n, const std::function<void(size_t)>& task);
+
+    unsigned size() const { return static_cast<unsigned>(workers_.size()) + 1; }
+
+private:
+    void workerLoop();
+    void drain(std::unique_lock<std::mutex>& lock);
+
+    std::vector<std::thread> workers_;
+
+    std::mutex              mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+
+    const std::function<void(size_t)>* task_ = nullptr;
+    size_t   next_       = 0;
+    size_t   count_      = 0;
+    size_t   pending_    = 0;
+    uint64_t generation_ = 0;
+    bool     stop_       = false;
+};
+
+#endif // THREAD_POOL_H
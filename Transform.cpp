@@ -0,0 +1,128 @@
+//------------------------------------------------------------------------------
+// File: Transform.cpp
+//
+// Affine coordinate transforms (see Transform.h).
+//------------------------------------------------------------------------------
+
+#include "Transform.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+//------------------------------------------------------------------------------
+// AffineTransform
+//------------------------------------------------------------------------------
+bool AffineTransform::isTranslation() const {
+    for (int r = 0; r < 3; ++r) {
+        for (int c = 0; c < 3; ++c) {
+            if (m[r][c] != (r == c ? 1.0 : 0.0)) return false;
+        }
+    }
+    return true;
+}
+
+bool AffineTransform::isIdentity() const {
+    return isTranslation() && m[0][3] == 0 && m[1][3] == 0 && m[2][3] == 0;
+}
+
+AffineTransform AffineTransform::after(const AffineTransform& first) const {
+    AffineTransform t;
+    for (int r = 0; r < 3; ++r) {
+        for (int c = 0; c < 4; ++c) {
+            double v = (c == 3) ? m[r][3] : 0.0;
+            for (int k = 0; k < 3; ++k) v += m[r][k] * first.m[k][c];
+            t.m[r][c] = v;
+        }
+    }
+    return t;
+}
+
+void AffineTransform::apply(const double* x, const double* y, const double* z, size_t n,
+                            double* ox, double* oy, double* oz) const {
+    const double m00 = m[0][0], m01 = m[0][1], m02 = m[0][2], m03 = m[0][3];
+    const double m10 = m[1][0], m11 = m[1][1], m12 = m[1][2], m13 = m[1][3];
+    const double m20 = m[2][0], m21 = m[2][1], m22 = m[2][2], m23 = m[2][3];
+
+    for (size_t i = 0; i < n; ++i) {
+        double px = x[i], py = y[i], pz = z[i];
+        ox[i] = m00 * px + m01 * py + m02 * pz + m03;
+        oy[i] = m10 * px + m11 * py + m12 * pz + m13;
+        oz[i] = m20 * px + m21 * py + m22 * pz + m23;
+    }
+}
+
+//------------------------------------------------------------------------------
+// Transform file
+//------------------------------------------------------------------------------
+bool loadTransform(const std::string& fileName, AffineTransform& transform) {
+
+    std::ifstream in(fileName);
+    if (!in) {
+        std::cerr << "Error opening transform file " << fileName << "\n";
+        return false;
+    }
+
+    std::vector<double> values;
+    std::string line;
+    int lineNo = 0;
+    while (std::getline(in, line)) {
+        ++lineNo;
+        size_t hash = line.find('#');
+        if (hash != std::string::npos) line.erase(hash);
+        for (char& c : line) {
+            if (c == ',') c = ' ';
+        }
+
+        const char* p = line.c_str();
+        for (;;) {
+            while (*p == ' ' || *p == '\t' || *p == '\r') ++p;
+            if (!*p) break;
+            char* end = nullptr;
+            double v = std::strtod(p, &end);
+            if (end == p) {
+                std::cerr << fileName << ":" << lineNo << ": expected a number\n";
+                return false;
+            }
+            // nan, inf or out of range (1e999): would spread to every point
+            if (!std::isfinite(v)) {
+                std::cerr << fileName << ":" << lineNo << ": "
+                          << std::string(p, end - p) << " is not a finite number\n";
+                return false;
+            }
+            values.push_back(v);
+            p = end;
+        }
+    }
+
+    if (values.size() != 12 && values.size() != 16) {
+        std::cerr << fileName << ": expected 12 or 16 numbers (4x4 matrix), found "
+                  << values.size() << "\n";
+        return false;
+    }
+    if (values.size() == 16 &&
+        (values[12] != 0 || values[13] != 0 || values[14] != 0 || values[15] != 1)) {
+        std::cerr << fileName << ": last row must be 0 0 0 1 (affine transform)\n";
+        return false;
+    }
+
+    for (int r = 0; r < 3; ++r) {
+        for (int c = 0; c < 4; ++c) transform.m[r][c] = values[r * 4 + c];
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+// Displacements are directions: linear part only
+//------------------------------------------------------------------------------
+void transformDisplacements(Geometry& geometry, const AffineTransform& transform) {
+    AffineTransform linear = transform;
+    linear.m[0][3] = linear.m[1][3] = linear.m[2][3] = 0;
+
+    for (DisplacementSet& s : geometry.sets) {
+        linear.apply(s.dx.data(), s.dy.data(), s.dz.data(), s.size(),
+                     s.dx.data(), s.dy.data(), s.dz.data());
+    }
+}
@@ -0,0 +1,64 @@
+/*------------------------------------------------------------------------------
+ * File: Transform.h
+ *
+ * Affine coordinate transforms for AddDisplacedPoints --pre-transform and
+ * --post-transform (typically a survey alignment: rotation + translation).
+ *
+ * A transform is a 4x4 matrix whose last row is 0 0 0 1, so p' = M p with
+ * p = (x, y, z, 1). apply() maps whole coordinate columns in one plain loop
+ * over the points, which the compiler vectorizes.
+ *
+ * With both transforms a displaced point is Post(Pre(p) + d). Since Post is
+ * affine this equals Post(Pre(p)) + L d, L being the linear part of Post,
+ * and that is how AddDisplacedPoints computes it: each input point is
+ * mapped once by the composed matrix when its block is expanded, and the
+ * displacements of the geometry once at startup (transformDisplacements()),
+ * so the expansion kernel itself is unchanged. The two forms are equal up
+ * to rounding in the last bit.
+ *
+ * With --orientation the displacements are rotated per point, in the input
+ * frame, so a displaced point is Post(Pre(p + R d)) = Post(Pre(p)) + L R d
+ * with L the linear part of Post∘Pre; L is then multiplied into each R
+ * (ExpandKernel.h) and the geometry is not transformed.
+ *
+ *------------------------------------------------------------------------------*/
+
+#ifndef TRANSFORM_H
+#define TRANSFORM_H
+
+#include <cstddef>
+#include <string>
+
+#include "Geometry.h"
+
+struct AffineTransform {
+    // Upper three rows of the 4x4 matrix: linear part | translation
+    double m[3][4] = { { 1, 0, 0, 0 }, { 0, 1, 0, 0 }, { 0, 0, 1, 0 } };
+
+    bool isIdentity() const;
+    bool isTranslation() const;     // linear part is the identity
+
+    // first, then this
+    AffineTransform after(const AffineTransform& first) const;
+
+    // (ox[i], oy[i], oz[i]) = M (x[i], y[i], z[i], 1) for i in [0, n); the
+    // output may be the input
+    void apply(const double* x, const double* y, const double* z, size_t n,
+               double* ox, double* oy, double* oz) const;
+};
+
+/*------------------------------------------------------------------------------
+ * Read a transform file: the 16 numbers of the 4x4 matrix row by row (the
+ * last row must be 0 0 0 1), or only the first 12. Numbers are separated by
+ * blanks, commas or newlines; '#' starts a comment. nan, inf and numbers out
+ * of range are rejected. On error prints a message with the file and line
+ * to stderr and returns false.
+ *------------------------------------------------------------------------------*/
+bool loadTransform(const std::string& fileName, AffineTransform& transform);
+
+/*------------------------------------------------------------------------------
+ * Map every displacement of geometry by the linear part of transform
+ *------------------------------------------------------------------------------*/
+void transformDisplacements(Geometry& geometry, const AffineTransform& transform);
+
+#endif // TRANSFORM_H